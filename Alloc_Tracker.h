@@ -0,0 +1,130 @@
+//Heap allocation tracking for the particle demos
+//Build with -DTRACK_ALLOCS to replace the global operator new/delete. Every allocation then goes
+//through allocHook, which by default counts it for the current frame. Point allocHook at your own
+//function to log or break on allocations instead. The particle arrays use ParticleVector so their
+//growth is counted separately as vector reallocations.
+//At exit allocTracker.report() prints the totals and the worst frames after warm up.
+//Without TRACK_ALLOCS everything here is a no-op and ParticleVector is a plain std::vector.
+//The operator replacements are definitions, so include this from one .cpp only (the demos are one file each).
+
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+struct AllocFrame {
+	long long frame = -1;
+	long long allocations = 0;
+	long long bytes = 0;
+	long long vectorReallocs = 0;
+};
+
+struct AllocTracker {
+	static const int worstCount = 5;
+	int warmupFrames = 60; //the first frames still load files and grow the arrays
+
+	//counted by the hook, reset every frame
+	std::atomic<long long> allocations{ 0 }, bytes{ 0 }, vectorReallocs{ 0 };
+
+	long long frameNumber = 0;
+	long long totalAllocations = 0, totalBytes = 0, totalReallocs = 0;
+	long long steadyFrames = 0, zeroAllocFrames = 0;
+	AllocFrame worst[worstCount]; //sorted by allocations, most first
+
+	void endFrame() {
+#ifdef TRACK_ALLOCS
+		AllocFrame f;
+		f.frame = frameNumber++;
+		f.allocations = allocations.exchange(0);
+		f.bytes = bytes.exchange(0);
+		f.vectorReallocs = vectorReallocs.exchange(0);
+		totalAllocations += f.allocations;
+		totalBytes += f.bytes;
+		totalReallocs += f.vectorReallocs;
+		if (f.frame < warmupFrames) return;
+
+		steadyFrames++;
+		if (f.allocations == 0) zeroAllocFrames++;
+		for (int i = 0; i < worstCount; i++) { //insert without allocating
+			if (worst[i].frame < 0 || f.allocations > worst[i].allocations) {
+				for (int j = worstCount - 1; j > i; j--) worst[j] = worst[j - 1];
+				worst[i] = f;
+				break;
+			}
+		}
+#endif
+	}
+
+	void report() const {
+#ifdef TRACK_ALLOCS
+		printf("\nHeap allocations over %lld frames: %lld allocations, %.1f KB, %lld vector reallocations\n",
+			frameNumber, totalAllocations, totalBytes / 1024.0, totalReallocs);
+		if (steadyFrames == 0) return;
+		printf("After %d warm up frames: %lld of %lld frames allocated nothing\n",
+			warmupFrames, zeroAllocFrames, steadyFrames);
+		printf("Worst frames:\n");
+		for (int i = 0; i < worstCount && worst[i].frame >= 0 && worst[i].allocations > 0; i++) {
+			printf("  frame %6lld: %6lld allocations, %10.1f KB, %4lld vector reallocations\n",
+				worst[i].frame, worst[i].allocations, worst[i].bytes / 1024.0, worst[i].vectorReallocs);
+		}
+#endif
+	}
+};
+
+AllocTracker allocTracker;
+
+inline void AllocTrackerCount(size_t size) {
+	allocTracker.allocations++;
+	allocTracker.bytes += size;
+}
+
+//called for every heap allocation when TRACK_ALLOCS is defined
+void(*allocHook)(size_t size) = AllocTrackerCount;
+
+//Allocator for the particle arrays, every allocate() is the vector growing
+template <class T>
+struct TrackedAllocator {
+	typedef T value_type;
+	TrackedAllocator() {}
+	template <class U> TrackedAllocator(const TrackedAllocator<U>&) {}
+	T* allocate(size_t n) {
+		allocTracker.vectorReallocs++;
+		return static_cast<T*>(::operator new(n * sizeof(T)));
+	}
+	void deallocate(T* p, size_t) { ::operator delete(p); }
+};
+template <class T, class U> bool operator==(const TrackedAllocator<T>&, const TrackedAllocator<U>&) { return true; }
+template <class T, class U> bool operator!=(const TrackedAllocator<T>&, const TrackedAllocator<U>&) { return false; }
+
+#ifdef TRACK_ALLOCS
+
+template <class T> using ParticleVector = std::vector<T, TrackedAllocator<T> >;
+
+void* operator new(size_t size) {
+	if (allocHook) allocHook(size);
+	void* p = malloc(size ? size : 1);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	if (allocHook) allocHook(size);
+	return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+#else
+
+template <class T> using ParticleVector = std::vector<T>;
+
+#endif
+
+#endif
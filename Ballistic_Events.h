@@ -0,0 +1,270 @@
+//Ballistic particles stepped by events instead of integrated every frame
+//Include after glad, glm, Alloc_Tracker.h, Shader_Manager.h and Mesh_Arena.h. Under constant gravity a
+//particle follows a parabola from its last launch (birth or bounce) until it hits the floor, so with
+//--analytic a particle only stores that launch. The time of its next floor impact goes into a min heap,
+//and step() only touches the particles whose impact time has passed: it bounces them and queues their
+//next impact. The launches live in a ring indexed by particle id (ids count every particle ever pushed).
+//All particles share one lifespan and are born in order, so the dead are always the oldest ids and
+//dropping them moves the ring's head; queued impacts of particles that died first are recognized by
+//their id and skipped. The ring is mirrored in a GPU buffer and only the slots of new or bounced
+//particles are uploaded. The BALLISTIC variant of vertex.glsl evaluates every parabola at the current
+//time from that buffer, so per frame the CPU only works on births, deaths and bounces.
+//  ballistic.init(gravity, floorZ, bounce, lifeSpan);
+//  ballistic.load(shaders);                                //before shaders.finish(), then addProgram both
+//  ballistic.upload(arena);                                //after arena.upload()
+//  ballistic.push(position, velocity);                     //new particles
+//  stats.died(ballistic.step(dt));                         //every frame
+//  stats.uploaded(ballistic.draw(program, sphere, radius, color, stats));
+//Times go to the GPU as float seconds since the start, about 0.2 ms steps after an hour.
+
+#ifndef BALLISTIC_EVENTS_H
+#define BALLISTIC_EVENTS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdint.h>
+
+struct BallisticEvent {
+	double time;
+	uint32_t id;
+	bool operator<(const BallisticEvent& other) const { return time > other.time; } //heap order, earliest on top
+};
+
+//One particle's launch as the BALLISTIC shader reads it, per instance
+struct BallisticLaunch {
+	glm::vec4 positionTime; //xyz = where, w = when
+	glm::vec4 velocity;     //xyz, w unused
+};
+
+struct BallisticParticles {
+	bool enabled = false; //--analytic
+	glm::vec3 gravity = glm::vec3(0.0f, 0.0f, -10.0f);
+	float floorZ = 0;
+	float restitution = 0.95f;
+	float lifeSpan = 1;
+	float restSpeed = 0.05f; //bounces slower than this end on the floor
+	double time = 0;
+	uint32_t firstId = 0, endId = 0; //the live particles are the ids in [firstId, endId)
+	int events = 0;                  //bounces handled by the last step()
+
+	//the ring, slot = id & (capacity - 1)
+	uint32_t capacity = 0;
+	ParticleVector<BallisticLaunch> launch;
+	ParticleVector<double> birthTime;
+	ParticleVector<BallisticEvent> impacts; //std heap, earliest impact first
+
+	//GPU side
+	GLuint program = 0, countProgram = 0;
+	GLuint vao = 0, buffer = 0;
+	uint32_t bufferCapacity = 0;   //slots allocated on the GPU, reallocated when the ring grows
+	uint32_t uploadedEnd = 0;      //ids below this were uploaded at birth
+	ParticleVector<uint32_t> dirty; //slots of bounced particles to upload
+	GLint timeLoc[2], gravityLoc[2], colorLoc[2];
+	bool located = false;
+
+	void init(const glm::vec3& g, float floor, float bounce, float life) {
+		gravity = g;
+		floorZ = floor;
+		restitution = bounce;
+		lifeSpan = life;
+	}
+
+	void load(ShaderManager& shaders) {
+		program = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED\n#define BALLISTIC");
+		countProgram = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED\n#define BALLISTIC\n#define OVERDRAW");
+	}
+
+	//A VAO with the arena's vertices and the launch buffer as the instance attributes
+	void upload(const MeshArena& arena) {
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, arena.vbo);
+		glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), 0);
+		glEnableVertexAttribArray(ATTRIB_POSITION);
+		glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+		glVertexAttribPointer(ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), (void*)(5 * sizeof(float)));
+		glEnableVertexAttribArray(ATTRIB_NORMAL);
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glVertexAttribPointer(ATTRIB_INST_CENTER_RADIUS, 4, GL_FLOAT, GL_FALSE, sizeof(BallisticLaunch), 0);
+		glVertexAttribDivisor(ATTRIB_INST_CENTER_RADIUS, 1);
+		glEnableVertexAttribArray(ATTRIB_INST_CENTER_RADIUS);
+		glVertexAttribPointer(ATTRIB_INST_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(BallisticLaunch), (void*)sizeof(glm::vec4));
+		glVertexAttribDivisor(ATTRIB_INST_COLOR, 1);
+		glEnableVertexAttribArray(ATTRIB_INST_COLOR);
+		glBindVertexArray(0);
+	}
+
+	size_t size() const { return endId - firstId; }
+	uint32_t slot(uint32_t id) const { return id & (capacity - 1); }
+
+	//When a particle launched from p with v at time t0 comes down on the floor
+	double impactTime(const glm::vec3& p, const glm::vec3& v, double t0) const {
+		if (gravity.z >= 0) return std::numeric_limits<double>::infinity();
+		double h = std::max(p.z - floorZ, 0.0f);
+		return t0 + (-v.z - std::sqrt((double)v.z * v.z - 2.0 * gravity.z * h)) / gravity.z;
+	}
+
+	//Where the particle with this id is at the current time (what the shader computes)
+	glm::vec3 position(uint32_t id) const {
+		const BallisticLaunch& l = launch[slot(id)];
+		float tau = (float)time - l.positionTime.w;
+		glm::vec3 p = glm::vec3(l.positionTime) + glm::vec3(l.velocity) * tau + gravity * (0.5f * tau * tau);
+		p.z = std::max(p.z, floorZ);
+		return p;
+	}
+
+	//Doubles the ring, the live ids move to their slots in the bigger one
+	void grow() {
+		uint32_t newCapacity = capacity ? 2 * capacity : 1024;
+		ParticleVector<BallisticLaunch> newLaunch(newCapacity);
+		ParticleVector<double> newBirth(newCapacity);
+		for (uint32_t id = firstId; id != endId; id++) {
+			newLaunch[id & (newCapacity - 1)] = launch[slot(id)];
+			newBirth[id & (newCapacity - 1)] = birthTime[slot(id)];
+		}
+		launch.swap(newLaunch);
+		birthTime.swap(newBirth);
+		capacity = newCapacity;
+		uploadedEnd = firstId; //everything goes up again
+		dirty.clear();
+	}
+
+	void push(const glm::vec3& p, const glm::vec3& v) {
+		if (size() == capacity) grow();
+		uint32_t id = endId++;
+		BallisticLaunch l = { glm::vec4(p, (float)time), glm::vec4(v, 0.0f) };
+		launch[slot(id)] = l;
+		birthTime[slot(id)] = time;
+		double hit = impactTime(p, v, time);
+		if (hit < time + lifeSpan) {
+			BallisticEvent e = { hit, id };
+			impacts.push_back(e);
+			std::push_heap(impacts.begin(), impacts.end());
+		}
+	}
+
+	//Advances the clock, drops the dead and bounces the particles that reached the floor since the last
+	//step. Returns how many died.
+	int step(float dt) {
+		time += dt;
+		uint32_t first = firstId;
+		while (firstId != endId && birthTime[slot(firstId)] + lifeSpan <= time) firstId++;
+		if (uploadedEnd - firstId > size()) uploadedEnd = firstId; //the births not uploaded yet died already
+
+		events = 0;
+		while (!impacts.empty() && impacts.front().time <= time) {
+			std::pop_heap(impacts.begin(), impacts.end());
+			BallisticEvent e = impacts.back();
+			impacts.pop_back();
+			if (e.id - firstId >= size()) continue; //died before it landed
+			BallisticLaunch& l = launch[slot(e.id)];
+			float tau = (float)(e.time - l.positionTime.w);
+			glm::vec3 p = glm::vec3(l.positionTime) + glm::vec3(l.velocity) * tau + gravity * (0.5f * tau * tau);
+			glm::vec3 v = glm::vec3(l.velocity) + gravity * tau;
+			p.z = floorZ;
+			v.z *= -restitution;
+			if (v.z < restSpeed) v.z = 0; //lies on the floor from now on, the shader keeps it there
+			l.positionTime = glm::vec4(p, (float)e.time);
+			l.velocity = glm::vec4(v, 0.0f);
+			if (e.id - uploadedEnd >= endId - uploadedEnd) dirty.push_back(slot(e.id)); //not in the next birth upload
+			if (v.z > 0) {
+				e.time = impactTime(p, v, e.time);
+				if (e.time < birthTime[slot(e.id)] + lifeSpan) {
+					impacts.push_back(e);
+					std::push_heap(impacts.begin(), impacts.end());
+				}
+			}
+			events++;
+		}
+		return firstId - first;
+	}
+
+	//Uploads the slots [begin, end) of the ring, returns the bytes
+	size_t uploadSlots(uint32_t begin, uint32_t end) {
+		if (end <= begin) return 0;
+		glBufferSubData(GL_ARRAY_BUFFER, begin * sizeof(BallisticLaunch), (end - begin) * sizeof(BallisticLaunch), &launch[begin]);
+		return (end - begin) * sizeof(BallisticLaunch);
+	}
+
+	//Brings the GPU copy up to date: the new particles and the bounced ones, adjacent slots in one go.
+	//Returns the bytes uploaded.
+	size_t sync() {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		size_t bytes = 0;
+		if (bufferCapacity != capacity) {
+			glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(BallisticLaunch), launch.data(), GL_DYNAMIC_DRAW);
+			bytes += capacity * sizeof(BallisticLaunch);
+			bufferCapacity = capacity;
+			dirty.clear();
+		}
+		else {
+			//births, in at most two pieces when they wrap around the ring
+			uint32_t count = endId - uploadedEnd, start = slot(uploadedEnd);
+			uint32_t before = std::min(count, capacity - start);
+			bytes += uploadSlots(start, start + before);
+			bytes += uploadSlots(0, count - before);
+			std::sort(dirty.begin(), dirty.end());
+			dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+			for (size_t k = 0; k < dirty.size();) {
+				size_t run = k + 1;
+				while (run < dirty.size() && dirty[run] == dirty[run - 1] + 1) run++;
+				bytes += uploadSlots(dirty[k], dirty[run - 1] + 1);
+				k = run;
+			}
+			dirty.clear();
+		}
+		uploadedEnd = endId;
+		return bytes;
+	}
+
+	void locate() {
+		GLuint programs[2] = { program, countProgram };
+		for (int p = 0; p < 2; p++) {
+			timeLoc[p] = glGetUniformLocation(programs[p], "ballisticTime");
+			gravityLoc[p] = glGetUniformLocation(programs[p], "gravity");
+			colorLoc[p] = glGetUniformLocation(programs[p], "inColor");
+		}
+		located = true;
+	}
+
+	//Syncs the GPU copy and draws every live particle as an instance of mesh with prog (program or
+	//countProgram), one draw, two when the live ids wrap around the ring. Returns the bytes uploaded.
+	size_t draw(GLuint prog, const MeshRange& mesh, float radius, const glm::vec3& color, ParticleStats& stats) {
+		if (capacity == 0) return 0;
+		size_t bytes = sync();
+		if (size() == 0) return bytes;
+		if (!located) locate();
+		int p = prog == countProgram ? 1 : 0;
+		glUseProgram(prog);
+		glBindVertexArray(vao);
+		glUniform4f(timeLoc[p], (float)time, floorZ, radius, 0.0f);
+		glUniform3f(gravityLoc[p], gravity.x, gravity.y, gravity.z);
+		glUniform3f(colorLoc[p], color.r, color.g, color.b);
+		uint32_t start = slot(firstId), count = size();
+		uint32_t before = std::min(count, capacity - start);
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLES, mesh.first, mesh.count, before, start);
+		stats.drew(mesh.count, before);
+		if (count > before) {
+			glDrawArraysInstancedBaseInstance(GL_TRIANGLES, mesh.first, mesh.count, count - before, 0);
+			stats.drew(mesh.count, count - before);
+		}
+		return bytes;
+	}
+
+	void deleteBuffers() {
+		glDeleteBuffers(1, &buffer);
+		glDeleteVertexArrays(1, &vao);
+	}
+};
+
+inline void BallisticParseArgs(BallisticParticles& ballistic, int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--analytic") == 0) ballistic.enabled = true;
+	}
+}
+
+#endif
@@ -0,0 +1,81 @@
+//Benchmark mode shared by the particle demos
+//  ./a.out --benchmark [frames]
+//Runs the scene with a fixed dt and a fixed random seed, times the simulate and render
+//phases separately and prints one JSON line on stdout when done. Benchmark_Compare.cpp
+//runs these lines several times per scene and checks them against benchmark_baseline.json
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct Benchmark {
+	bool enabled = false;
+	const char* scene = "";
+	int warmupFrames = 60; //not measured, lets the particle count reach steady state
+	int frames = 600;
+	int frame = 0;
+	float dt = 1.0f / 60.0f;
+	unsigned int seed = 5611;
+
+	double simTime = 0, renderTime = 0;
+	double particleFrames = 0; //sum of the live particle count over the measured frames
+	double phaseStart = 0;
+
+	static double now() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	bool measuring() const { return enabled && frame >= warmupFrames; }
+	bool done() const { return enabled && frame >= warmupFrames + frames; }
+
+	void beginFrame() { phaseStart = now(); }
+
+	//call after spawning and updating the particles
+	void endSimulate(size_t liveParticles) {
+		double t = now();
+		if (measuring()) {
+			simTime += t - phaseStart;
+			particleFrames += liveParticles;
+		}
+		phaseStart = t;
+	}
+
+	//call after the draw calls have finished (glFinish) so GPU time is included
+	void endRender() {
+		double t = now();
+		if (measuring()) renderTime += t - phaseStart;
+		phaseStart = t;
+		frame++;
+	}
+
+	void report() const {
+		double n = frames > 0 ? frames : 1;
+		double total = simTime + renderTime;
+		printf("{\"scene\":\"%s\",\"frames\":%d,\"dt\":%g,\"avg_particles\":%.1f,"
+			"\"sim_ms\":%.4f,\"render_ms\":%.4f,\"frame_ms\":%.4f,"
+			"\"sim_particles_per_sec\":%.1f,\"particles_per_sec\":%.1f}\n",
+			scene, frames, dt, particleFrames / n,
+			simTime * 1000 / n, renderTime * 1000 / n, total * 1000 / n,
+			simTime > 0 ? particleFrames / simTime : 0.0,
+			total > 0 ? particleFrames / total : 0.0);
+		fflush(stdout);
+	}
+};
+
+//Returns true if --benchmark was given. An optional number after it sets the measured frames
+inline bool BenchmarkParseArgs(Benchmark& bench, const char* scene, int argc, char* argv[]) {
+	bench.scene = scene;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--benchmark") == 0) {
+			bench.enabled = true;
+			if (i + 1 < argc && atoi(argv[i + 1]) > 0) bench.frames = atoi(argv[++i]);
+		}
+	}
+	return bench.enabled;
+}
+
+#endif
@@ -0,0 +1,328 @@
+//Benchmark regression gate for the particle demos
+//  g++ Benchmark_Compare.cpp -o Benchmark_Compare
+//  ./Benchmark_Compare [--baseline benchmark_baseline.json] [--runs 5] [--frames 600] [--threshold 0.1] [--write-baseline]
+
+//Every scene listed in the baseline file is run several times as "<command> --benchmark <frames>"
+//(see Benchmark.h). For each scene it prints the mean and 95% confidence interval of the frame,
+//simulate and render times together with the particle throughput, then compares the frame time
+//against the stored baseline. The exit code is 1 when a scene got slower than the threshold allows,
+//2 when a scene could not be run and 0 otherwise.
+//--write-baseline stores the measured means back into the baseline file instead of comparing.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+using namespace std;
+
+//=================
+//|| tiny JSON   ||
+//=================
+
+struct JsonValue {
+	enum Type { Null, Bool, Number, String, Array, Object };
+	Type type = Null;
+	bool boolean = false;
+	double number = 0;
+	string str;
+	vector<JsonValue> items;
+	vector<pair<string, JsonValue> > members;
+
+	const JsonValue* get(const char* key) const {
+		for (size_t i = 0; i < members.size(); i++) {
+			if (members[i].first == key) return &members[i].second;
+		}
+		return NULL;
+	}
+	double getNumber(const char* key, double fallback) const {
+		const JsonValue* v = get(key);
+		return (v && v->type == Number) ? v->number : fallback;
+	}
+	string getString(const char* key) const {
+		const JsonValue* v = get(key);
+		return (v && v->type == String) ? v->str : string();
+	}
+};
+
+struct JsonParser {
+	const char* p;
+	bool ok = true;
+
+	void skip() { while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++; }
+
+	bool parse(JsonValue& out) {
+		skip();
+		if (*p == '{') {
+			out.type = JsonValue::Object;
+			p++; skip();
+			if (*p == '}') { p++; return true; }
+			while (ok) {
+				JsonValue key;
+				skip();
+				if (*p != '"' || !parseString(key.str)) return ok = false;
+				skip();
+				if (*p++ != ':') return ok = false;
+				out.members.push_back(make_pair(key.str, JsonValue()));
+				if (!parse(out.members.back().second)) return ok = false;
+				skip();
+				if (*p == ',') { p++; continue; }
+				if (*p == '}') { p++; return true; }
+				return ok = false;
+			}
+			return false;
+		}
+		if (*p == '[') {
+			out.type = JsonValue::Array;
+			p++; skip();
+			if (*p == ']') { p++; return true; }
+			while (ok) {
+				out.items.push_back(JsonValue());
+				if (!parse(out.items.back())) return ok = false;
+				skip();
+				if (*p == ',') { p++; continue; }
+				if (*p == ']') { p++; return true; }
+				return ok = false;
+			}
+			return false;
+		}
+		if (*p == '"') {
+			out.type = JsonValue::String;
+			return parseString(out.str);
+		}
+		if (strncmp(p, "null", 4) == 0) { p += 4; out.type = JsonValue::Null; return true; }
+		if (strncmp(p, "true", 4) == 0) { p += 4; out.type = JsonValue::Bool; out.boolean = true; return true; }
+		if (strncmp(p, "false", 5) == 0) { p += 5; out.type = JsonValue::Bool; return true; }
+		char* end;
+		out.number = strtod(p, &end);
+		if (end == p) return ok = false;
+		out.type = JsonValue::Number;
+		p = end;
+		return true;
+	}
+
+	bool parseString(string& out) {
+		p++; //opening quote
+		while (*p && *p != '"') {
+			if (*p == '\\' && p[1]) p++; //escapes are kept as the escaped character
+			out += *p++;
+		}
+		if (*p != '"') return ok = false;
+		p++;
+		return true;
+	}
+};
+
+bool ParseJson(const string& text, JsonValue& out) {
+	JsonParser parser;
+	parser.p = text.c_str();
+	return parser.parse(out) && parser.ok;
+}
+
+//=================
+//|| statistics  ||
+//=================
+
+struct Sample {
+	double mean = 0, ci = 0; //ci is the half width of the 95% confidence interval
+	int n = 0;
+};
+
+//two sided 95% Student t values for 1..30 degrees of freedom
+double TValue95(int dof) {
+	static const double t[30] = {
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+	if (dof < 1) return 0;
+	if (dof <= 30) return t[dof - 1];
+	return 1.96;
+}
+
+Sample Summarize(const vector<double>& values) {
+	Sample s;
+	s.n = values.size();
+	if (s.n == 0) return s;
+	for (int i = 0; i < s.n; i++) s.mean += values[i];
+	s.mean /= s.n;
+	if (s.n > 1) {
+		double var = 0;
+		for (int i = 0; i < s.n; i++) var += (values[i] - s.mean)*(values[i] - s.mean);
+		var /= s.n - 1;
+		s.ci = TValue95(s.n - 1) * sqrt(var / s.n);
+	}
+	return s;
+}
+
+//=================
+//|| runner      ||
+//=================
+
+const char* metricNames[] = { "frame_ms", "sim_ms", "render_ms", "particles_per_sec", "avg_particles" };
+const int numMetrics = 5;
+
+struct SceneResult {
+	string name, command;
+	double threshold;
+	double baseline; //baseline frame_ms, <= 0 if none recorded yet
+	vector<double> values[numMetrics];
+	Sample stats[numMetrics];
+	bool failed = false;
+};
+
+//Runs the scene once and appends its metrics. Returns false if it did not produce a result line
+bool RunScene(SceneResult& scene, int frames) {
+	stringstream cmd;
+	cmd << scene.command << " --benchmark " << frames;
+	FILE* pipe = popen(cmd.str().c_str(), "r");
+	if (pipe == NULL) return false;
+
+	char line[4096];
+	JsonValue result;
+	bool found = false;
+	while (fgets(line, sizeof(line), pipe)) {
+		if (strstr(line, "\"scene\"") && line[0] == '{') {
+			found = ParseJson(line, result);
+		}
+	}
+	int status = pclose(pipe);
+	if (!found || status != 0) return false;
+
+	for (int m = 0; m < numMetrics; m++) {
+		scene.values[m].push_back(result.getNumber(metricNames[m], 0));
+	}
+	return true;
+}
+
+void WriteBaseline(const char* path, const vector<SceneResult>& scenes, double threshold, int runs, int frames) {
+	ofstream out(path);
+	out << "{\n";
+	out << "\t\"threshold\": " << threshold << ",\n";
+	out << "\t\"runs\": " << runs << ",\n";
+	out << "\t\"frames\": " << frames << ",\n";
+	out << "\t\"scenes\": [\n";
+	for (size_t i = 0; i < scenes.size(); i++) {
+		const SceneResult& s = scenes[i];
+		out << "\t\t{\"name\": \"" << s.name << "\", \"command\": \"" << s.command << "\"";
+		if (s.threshold != threshold) out << ", \"threshold\": " << s.threshold;
+		if (!s.failed) {
+			for (int m = 0; m < numMetrics; m++) out << ", \"" << metricNames[m] << "\": " << s.stats[m].mean;
+			out << ", \"frame_ms_ci\": " << s.stats[0].ci;
+		}
+		else {
+			out << ", \"frame_ms\": null";
+		}
+		out << "}" << (i + 1 < scenes.size() ? "," : "") << "\n";
+	}
+	out << "\t]\n}\n";
+}
+
+int main(int argc, char *argv[]) {
+	const char* baselinePath = "benchmark_baseline.json";
+	int runs = -1, frames = -1;
+	double threshold = -1;
+	bool writeBaseline = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baselinePath = argv[++i];
+		else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) runs = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) threshold = atof(argv[++i]);
+		else if (strcmp(argv[i], "--write-baseline") == 0) writeBaseline = true;
+		else {
+			printf("usage: %s [--baseline file] [--runs N] [--frames N] [--threshold fraction] [--write-baseline]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	ifstream file(baselinePath);
+	if (!file) {
+		printf("ERROR: Could not open baseline %s\n", baselinePath);
+		return 2;
+	}
+	stringstream text;
+	text << file.rdbuf();
+	JsonValue baseline;
+	if (!ParseJson(text.str(), baseline) || baseline.type != JsonValue::Object) {
+		printf("ERROR: Could not parse baseline %s\n", baselinePath);
+		return 2;
+	}
+
+	//command line overrides the values stored in the baseline
+	if (threshold < 0) threshold = baseline.getNumber("threshold", 0.10);
+	if (runs < 1) runs = (int)baseline.getNumber("runs", 5);
+	if (frames < 1) frames = (int)baseline.getNumber("frames", 600);
+
+	vector<SceneResult> scenes;
+	const JsonValue* list = baseline.get("scenes");
+	for (size_t i = 0; list && i < list->items.size(); i++) {
+		const JsonValue& entry = list->items[i];
+		SceneResult s;
+		s.name = entry.getString("name");
+		s.command = entry.getString("command");
+		s.threshold = entry.getNumber("threshold", threshold);
+		s.baseline = entry.getNumber("frame_ms", 0);
+		if (s.command.empty()) continue;
+		scenes.push_back(s);
+	}
+	if (scenes.empty()) {
+		printf("ERROR: No scenes listed in %s\n", baselinePath);
+		return 2;
+	}
+
+	printf("%d runs of %d frames per scene, regression threshold %.1f%%\n\n", runs, frames, threshold * 100);
+
+	int regressions = 0, failures = 0;
+	for (size_t i = 0; i < scenes.size(); i++) {
+		SceneResult& s = scenes[i];
+		for (int r = 0; r < runs && !s.failed; r++) {
+			if (!RunScene(s, frames)) s.failed = true;
+		}
+		if (s.failed) {
+			printf("%-14s FAILED to run \"%s\"\n\n", s.name.c_str(), s.command.c_str());
+			failures++;
+			continue;
+		}
+		for (int m = 0; m < numMetrics; m++) s.stats[m] = Summarize(s.values[m]);
+
+		const Sample& frame = s.stats[0];
+		printf("%-14s frame %8.3f +- %.3f ms  (sim %.3f +- %.3f, render %.3f +- %.3f)\n", s.name.c_str(),
+			frame.mean, frame.ci, s.stats[1].mean, s.stats[1].ci, s.stats[2].mean, s.stats[2].ci);
+		printf("%-14s throughput %.0f +- %.0f particles/s, %.0f particles on average\n", "",
+			s.stats[3].mean, s.stats[3].ci, s.stats[4].mean);
+
+		if (writeBaseline) {
+			printf("\n");
+			continue;
+		}
+		if (s.baseline <= 0) {
+			printf("%-14s no baseline recorded, run with --write-baseline\n\n", "");
+			continue;
+		}
+		double change = (frame.mean - s.baseline) / s.baseline;
+		//only call it a regression if it is past the threshold and outside the noise of this run
+		bool regressed = change > s.threshold && frame.mean - frame.ci > s.baseline;
+		printf("%-14s baseline %.3f ms, change %+.1f%% -> %s\n\n", "", s.baseline, change * 100,
+			regressed ? "REGRESSION" : (change < -s.threshold ? "faster" : "ok"));
+		if (regressed) regressions++;
+	}
+
+	if (writeBaseline) {
+		WriteBaseline(baselinePath, scenes, threshold, runs, frames);
+		printf("Baseline written to %s\n", baselinePath);
+		return failures ? 2 : 0;
+	}
+
+	if (regressions) printf("%d scene(s) regressed\n", regressions);
+	if (failures) return 2;
+	return regressions ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+//Color and alpha of particles over their normalized age, looked up instead of stored per particle
+//Include after glad and glm. Every gradient is a few keys (age in [0,1] and rgba) baked into one row of a
+//small RGBA8 texture, one row per emitter, so a particle only keeps its age and its row.
+//Programs built with GRADIENT next to INSTANCED (vertex.glsl) take the instance color as (age, row) and
+//look the color and alpha up in the vertex shader, the texture goes in through submit():
+//  GradientKey flame[] = { {0.0f, glm::vec4(1, 1, 1, 1)}, {1.0f, glm::vec4(1, 0, 0, 0)} };
+//  int row = gradients.add(flame, 2);  //every gradient before upload()
+//  gradients.upload();
+//  queue.submit(program, sphere, position[i], radius, gradients.at(row, age), 1.0f, gradients.tex);
+
+#ifndef COLOR_GRADIENT_H
+#define COLOR_GRADIENT_H
+
+#include <vector>
+
+struct GradientKey {
+	float age;
+	glm::vec4 color;
+};
+
+struct ColorGradients {
+	int resolution = 64; //texels per gradient
+	int rows = 0;
+	std::vector<unsigned char> texels;
+	GLuint tex = 0;
+
+	//Bakes keys (sorted by age) into a new row and returns it, before the first and after the last key
+	//the end colors hold
+	int add(const GradientKey* keys, int count) {
+		for (int x = 0; x < resolution; x++) {
+			float age = x / (float)(resolution - 1);
+			int k = 0;
+			while (k + 1 < count && keys[k + 1].age < age) k++;
+			glm::vec4 c = keys[k].color;
+			if (k + 1 < count && age > keys[k].age) {
+				float t = (age - keys[k].age) / (keys[k + 1].age - keys[k].age);
+				c = glm::mix(keys[k].color, keys[k + 1].color, t > 1 ? 1.0f : t);
+			}
+			for (int j = 0; j < 4; j++) texels.push_back((unsigned char)(glm::clamp(c[j], 0.0f, 1.0f) * 255 + 0.5f));
+		}
+		return rows++;
+	}
+
+	void upload() {
+		glGenTextures(1, &tex);
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, resolution, rows, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); //along the age, the rows are sampled at their centers
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	//What a GRADIENT program takes in place of the color
+	static glm::vec3 at(int row, float age) { return glm::vec3(age, (float)row, 0.0f); }
+
+	void deleteTexture() {
+		glDeleteTextures(1, &tex);
+	}
+};
+
+#endif
@@ -0,0 +1,369 @@
+//Compact particle state for scenes where the simulation is memory bound
+//Include after glad, glm, Alloc_Tracker.h, Shader_Manager.h, Mesh_Arena.h and Frustum_Cull.h. With
+//--compact a particle takes 14 bytes instead of 28: the position quantized to 16 bits per axis inside the
+//emitter's bounds, the velocity as half floats and the age as a 16 bit fraction of the lifespan, all in
+//separate arrays. step() unpacks 4 particles at a time with SSE2 (F16C for the halves when the compiler
+//targets it, e.g. -mf16c), integrates them, packs them back and drops the dead ones keeping the order.
+//Nothing goes back to floats for drawing. step() also keeps the quantized bounds of every block of
+//COMPACT_BLOCK particles, cull() tests those boxes against the frustum and draw() uploads the 16 bit
+//positions of the visible blocks as they are, 6 bytes a particle instead of a 32 byte arena instance.
+//The COMPACT variant of vertex.glsl reads them as normalized unsigned shorts and scales them into the
+//bounds.
+//Positions outside the bounds are clamped to them and moves under half a step are lost, so pick bounds
+//that hold the whole effect but no more.
+//  compact.init(boundsMin, boundsMax, maxLifeSpan);
+//  compact.load(shaders);                                   //before shaders.finish(), then queue.addProgram both
+//  compact.upload(arena);                                   //after arena.upload()
+//  compact.push(position, velocity);                        //new particles
+//  stats.died(compact.step(dt, gravity, floorZ, bounce));  //every frame
+//  stats.culled(compact.cull(frustum, radius));
+//  stats.uploaded(compact.draw(program, sphere, radius, color, stats));
+
+#ifndef COMPACT_PARTICLES_H
+#define COMPACT_PARTICLES_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COMPACT_SSE
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+#endif
+
+#define COMPACT_DEAD 65535 //age of a particle that reached its lifespan
+#define COMPACT_BLOCK 1024 //particles per culled block
+
+//IEEE half precision, rounded to nearest even (Giesen's float_to_half_fast3_rtne)
+inline uint16_t FloatToHalf(float value) {
+	uint32_t f;
+	memcpy(&f, &value, 4);
+	uint32_t sign = f & 0x80000000u;
+	f ^= sign;
+	uint16_t h;
+	if (f >= 0x47800000u) { //too big for a half, or inf/nan
+		h = f > 0x7f800000u ? 0x7e00 : 0x7c00;
+	}
+	else if (f < 0x38800000u) { //subnormal or zero, let the float adder do the rounding
+		uint32_t magicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+		float magic, sum;
+		memcpy(&magic, &magicBits, 4);
+		memcpy(&sum, &f, 4);
+		sum += magic;
+		memcpy(&f, &sum, 4);
+		h = (uint16_t)(f - magicBits);
+	}
+	else {
+		uint32_t mantOdd = (f >> 13) & 1;
+		f += ((uint32_t)(15 - 127) << 23) + 0xfff;
+		f += mantOdd;
+		h = (uint16_t)(f >> 13);
+	}
+	return h | (uint16_t)(sign >> 16);
+}
+
+inline float HalfToFloat(uint16_t h) {
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exp = (h >> 10) & 0x1f, mant = h & 0x3ff;
+	uint32_t f;
+	if (exp == 0) { //subnormal or zero
+		float v = mant * (1.0f / 16777216.0f); //2^-24
+		memcpy(&f, &v, 4);
+		f |= sign;
+	}
+	else if (exp == 31) f = sign | 0x7f800000u | (mant << 13);
+	else f = sign | ((exp + 112) << 23) | (mant << 13);
+	float value;
+	memcpy(&value, &f, 4);
+	return value;
+}
+
+#ifdef COMPACT_SSE
+static inline __m128 CompactLoadUnorm4(const uint16_t* q) {
+	return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)q), _mm_setzero_si128()));
+}
+
+//Rounds and clamps to [0,65535], packed with a bias since SSE2 only packs signed
+static inline void CompactStoreUnorm4(uint16_t* q, __m128 v) {
+	v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(65535.0f));
+	__m128i i = _mm_sub_epi32(_mm_cvtps_epi32(v), _mm_set1_epi32(32768));
+	i = _mm_xor_si128(_mm_packs_epi32(i, i), _mm_set1_epi16((short)0x8000));
+	_mm_storel_epi64((__m128i*)q, i);
+}
+
+static inline __m128 CompactLoadHalf4(const uint16_t* h) {
+#ifdef __F16C__
+	return _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)h));
+#else
+	return _mm_setr_ps(HalfToFloat(h[0]), HalfToFloat(h[1]), HalfToFloat(h[2]), HalfToFloat(h[3]));
+#endif
+}
+
+static inline void CompactStoreHalf4(uint16_t* h, __m128 v) {
+#ifdef __F16C__
+	_mm_storel_epi64((__m128i*)h, _mm_cvtps_ph(v, 0));
+#else
+	float f[4];
+	_mm_storeu_ps(f, v);
+	for (int k = 0; k < 4; k++) h[k] = FloatToHalf(f[k]);
+#endif
+}
+#endif
+
+//Quantized bounds of a block of particles
+struct CompactBlock {
+	uint16_t lo[3], hi[3];
+};
+
+//Particles [first, first + count) are drawn
+struct CompactRun {
+	uint32_t first, count;
+};
+
+struct CompactParticles {
+	bool enabled = false; //--compact
+	glm::vec3 boundsMin, boundsMax;
+	glm::vec3 scale, invScale; //bounds size / 65535 and its inverse
+	float maxAge = 1;
+	ParticleVector<uint16_t> px, py, pz; //16 bit fractions of the bounds
+	ParticleVector<uint16_t> vx, vy, vz; //half floats
+	ParticleVector<uint16_t> age;        //fraction of maxAge, COMPACT_DEAD at the end
+	ParticleVector<CompactBlock> blocks; //of COMPACT_BLOCK particles each, the last one partial
+	ParticleVector<CompactRun> runs;     //visible blocks, adjacent ones merged
+
+	//GPU side
+	GLuint program = 0, countProgram = 0;
+	GLuint vao = 0, buffers[3] = { 0, 0, 0 }; //px, py, pz
+	GLint boundsLoc[2], sizeLoc[2], colorLoc[2];
+	bool located = false;
+
+	void init(const glm::vec3& lo, const glm::vec3& hi, float lifeSpan) {
+		boundsMin = lo;
+		boundsMax = hi;
+		scale = (hi - lo) / 65535.0f;
+		invScale = glm::vec3(1.0f) / scale;
+		maxAge = lifeSpan;
+	}
+
+	void load(ShaderManager& shaders) {
+		program = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED\n#define COMPACT");
+		countProgram = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED\n#define COMPACT\n#define OVERDRAW");
+	}
+
+	//A VAO with the arena's vertices and one instance attribute per quantized axis
+	void upload(const MeshArena& arena) {
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, arena.vbo);
+		glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), 0);
+		glEnableVertexAttribArray(ATTRIB_POSITION);
+		glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+		glVertexAttribPointer(ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), (void*)(5 * sizeof(float)));
+		glEnableVertexAttribArray(ATTRIB_NORMAL);
+		glGenBuffers(3, buffers);
+		GLuint attribs[3] = { ATTRIB_INST_CENTER_RADIUS, ATTRIB_INST_COLOR, ATTRIB_INST_EXTRA };
+		for (int a = 0; a < 3; a++) {
+			glBindBuffer(GL_ARRAY_BUFFER, buffers[a]);
+			glVertexAttribPointer(attribs[a], 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(uint16_t), 0);
+			glVertexAttribDivisor(attribs[a], 1);
+			glEnableVertexAttribArray(attribs[a]);
+		}
+		glBindVertexArray(0);
+	}
+
+	size_t size() const { return age.size(); }
+	size_t bytes() const { return size() * 7 * sizeof(uint16_t); }
+
+	static uint16_t quantize(float v) {
+		v = v < 0 ? 0 : (v > 65535 ? 65535 : v);
+		return (uint16_t)(v + 0.5f);
+	}
+
+	void push(const glm::vec3& p, const glm::vec3& v) {
+		glm::vec3 q = (p - boundsMin) * invScale;
+		px.push_back(quantize(q.x));
+		py.push_back(quantize(q.y));
+		pz.push_back(quantize(q.z));
+		vx.push_back(FloatToHalf(v.x));
+		vy.push_back(FloatToHalf(v.y));
+		vz.push_back(FloatToHalf(v.z));
+		age.push_back(0);
+	}
+
+	glm::vec3 position(size_t i) const {
+		return boundsMin + glm::vec3(px[i], py[i], pz[i]) * scale;
+	}
+
+	//Ages and moves every particle under gravity with a bounce off the floor plane z = floorZ (semi
+	//implicit Euler, like computePhysics in the demos), removes the dead ones and updates the blocks'
+	//bounds. Returns how many died.
+	int step(float dt, const glm::vec3& gravity, float floorZ, float bounce) {
+		int n = size();
+		float ageStep = dt / maxAge * 65535.0f + 0.5f;
+		uint16_t ageInc = ageStep < 1 ? 1 : (ageStep > 65535 ? 65535 : (uint16_t)ageStep);
+		float floorQ = (floorZ - boundsMin.z) * invScale.z; //the floor in quantized units
+		int i = 0;
+#ifdef COMPACT_SSE
+		__m128i inc = _mm_set1_epi16((short)ageInc);
+		for (; i + 8 <= n; i += 8) { //saturates at COMPACT_DEAD
+			__m128i a = _mm_loadu_si128((const __m128i*)&age[i]);
+			_mm_storeu_si128((__m128i*)&age[i], _mm_adds_epu16(a, inc));
+		}
+#endif
+		for (; i < n; i++) age[i] = age[i] > COMPACT_DEAD - ageInc ? COMPACT_DEAD : age[i] + ageInc;
+
+		i = 0;
+#ifdef COMPACT_SSE
+		__m128 dtv = _mm_set1_ps(dt);
+		__m128 gx = _mm_set1_ps(gravity.x * dt), gy = _mm_set1_ps(gravity.y * dt), gz = _mm_set1_ps(gravity.z * dt);
+		__m128 ix = _mm_set1_ps(invScale.x), iy = _mm_set1_ps(invScale.y), iz = _mm_set1_ps(invScale.z);
+		__m128 floorv = _mm_set1_ps(floorQ), bouncev = _mm_set1_ps(-bounce);
+		for (; i + 4 <= n; i += 4) {
+			__m128 velX = _mm_add_ps(CompactLoadHalf4(&vx[i]), gx);
+			__m128 velY = _mm_add_ps(CompactLoadHalf4(&vy[i]), gy);
+			__m128 velZ = _mm_add_ps(CompactLoadHalf4(&vz[i]), gz);
+			//the positions stay in quantized units, the velocity is scaled into them
+			__m128 qx = _mm_add_ps(CompactLoadUnorm4(&px[i]), _mm_mul_ps(_mm_mul_ps(velX, dtv), ix));
+			__m128 qy = _mm_add_ps(CompactLoadUnorm4(&py[i]), _mm_mul_ps(_mm_mul_ps(velY, dtv), iy));
+			__m128 qz = _mm_add_ps(CompactLoadUnorm4(&pz[i]), _mm_mul_ps(_mm_mul_ps(velZ, dtv), iz));
+			__m128 below = _mm_cmplt_ps(qz, floorv);
+			qz = _mm_or_ps(_mm_and_ps(below, floorv), _mm_andnot_ps(below, qz));
+			velZ = _mm_or_ps(_mm_and_ps(below, _mm_mul_ps(velZ, bouncev)), _mm_andnot_ps(below, velZ));
+			CompactStoreHalf4(&vx[i], velX);
+			CompactStoreHalf4(&vy[i], velY);
+			CompactStoreHalf4(&vz[i], velZ);
+			CompactStoreUnorm4(&px[i], qx);
+			CompactStoreUnorm4(&py[i], qy);
+			CompactStoreUnorm4(&pz[i], qz);
+		}
+#endif
+		for (; i < n; i++) {
+			glm::vec3 v = glm::vec3(HalfToFloat(vx[i]), HalfToFloat(vy[i]), HalfToFloat(vz[i])) + gravity * dt;
+			glm::vec3 q = glm::vec3(px[i], py[i], pz[i]) + v * dt * invScale;
+			if (q.z < floorQ) {
+				q.z = floorQ;
+				v.z *= -bounce;
+			}
+			vx[i] = FloatToHalf(v.x);
+			vy[i] = FloatToHalf(v.y);
+			vz[i] = FloatToHalf(v.z);
+			px[i] = quantize(q.x);
+			py[i] = quantize(q.y);
+			pz[i] = quantize(q.z);
+		}
+
+		//drop the dead ones, keeping the order
+		int alive = 0;
+		for (i = 0; i < n; i++) {
+			if (age[i] == COMPACT_DEAD) continue;
+			if (alive != i) {
+				px[alive] = px[i]; py[alive] = py[i]; pz[alive] = pz[i];
+				vx[alive] = vx[i]; vy[alive] = vy[i]; vz[alive] = vz[i];
+				age[alive] = age[i];
+			}
+			alive++;
+		}
+		if (alive != n) {
+			px.resize(alive); py.resize(alive); pz.resize(alive);
+			vx.resize(alive); vy.resize(alive); vz.resize(alive);
+			age.resize(alive);
+		}
+		updateBlocks();
+		return n - alive;
+	}
+
+	void updateBlocks() {
+		size_t n = size();
+		blocks.resize((n + COMPACT_BLOCK - 1) / COMPACT_BLOCK);
+		const ParticleVector<uint16_t>* axes[3] = { &px, &py, &pz };
+		for (size_t b = 0; b < blocks.size(); b++) {
+			size_t first = b * COMPACT_BLOCK, last = std::min(first + COMPACT_BLOCK, n);
+			for (int a = 0; a < 3; a++) {
+				const uint16_t* q = axes[a]->data();
+				uint16_t lo = 65535, hi = 0;
+				for (size_t i = first; i < last; i++) { //plain min/max, the compiler vectorizes it
+					lo = q[i] < lo ? q[i] : lo;
+					hi = q[i] > hi ? q[i] : hi;
+				}
+				blocks[b].lo[a] = lo;
+				blocks[b].hi[a] = hi;
+			}
+		}
+	}
+
+	//Finds the blocks whose particles can be on screen, returns how many particles were culled
+	int cull(const Frustum& frustum, float radius) {
+		runs.clear();
+		size_t n = size(), drawn = 0;
+		for (size_t b = 0; b < blocks.size(); b++) {
+			const CompactBlock& block = blocks[b];
+			glm::vec3 lo = boundsMin + glm::vec3(block.lo[0], block.lo[1], block.lo[2]) * scale - glm::vec3(radius);
+			glm::vec3 hi = boundsMin + glm::vec3(block.hi[0], block.hi[1], block.hi[2]) * scale + glm::vec3(radius);
+			if (!frustum.boxVisible(lo, hi)) continue;
+			uint32_t first = b * COMPACT_BLOCK, count = std::min(first + COMPACT_BLOCK, (uint32_t)n) - first;
+			if (!runs.empty() && runs.back().first + runs.back().count == first) runs.back().count += count;
+			else {
+				CompactRun run = { first, count };
+				runs.push_back(run);
+			}
+			drawn += count;
+		}
+		return n - drawn;
+	}
+
+	void locate() {
+		GLuint programs[2] = { program, countProgram };
+		for (int p = 0; p < 2; p++) {
+			boundsLoc[p] = glGetUniformLocation(programs[p], "boundsMinRadius");
+			sizeLoc[p] = glGetUniformLocation(programs[p], "boundsSize");
+			colorLoc[p] = glGetUniformLocation(programs[p], "inColor");
+		}
+		located = true;
+	}
+
+	//Uploads the quantized positions of the runs cull() found and draws them as instances of mesh with
+	//prog (program or countProgram), one draw per run. Returns the bytes uploaded.
+	size_t draw(GLuint prog, const MeshRange& mesh, float radius, const glm::vec3& color, ParticleStats& stats) {
+		if (runs.empty()) return 0;
+		if (!located) locate();
+		const ParticleVector<uint16_t>* axes[3] = { &px, &py, &pz };
+		size_t bytes = 0;
+		for (int a = 0; a < 3; a++) {
+			glBindBuffer(GL_ARRAY_BUFFER, buffers[a]);
+			glBufferData(GL_ARRAY_BUFFER, size() * sizeof(uint16_t), NULL, GL_STREAM_DRAW); //only the runs are filled
+			for (size_t r = 0; r < runs.size(); r++) {
+				glBufferSubData(GL_ARRAY_BUFFER, runs[r].first * sizeof(uint16_t), runs[r].count * sizeof(uint16_t), &(*axes[a])[runs[r].first]);
+				bytes += runs[r].count * sizeof(uint16_t);
+			}
+		}
+		int p = prog == countProgram ? 1 : 0;
+		glm::vec3 size = boundsMax - boundsMin;
+		glUseProgram(prog);
+		glBindVertexArray(vao);
+		glUniform4f(boundsLoc[p], boundsMin.x, boundsMin.y, boundsMin.z, radius);
+		glUniform3f(sizeLoc[p], size.x, size.y, size.z);
+		glUniform3f(colorLoc[p], color.r, color.g, color.b);
+		for (size_t r = 0; r < runs.size(); r++) {
+			glDrawArraysInstancedBaseInstance(GL_TRIANGLES, mesh.first, mesh.count, runs[r].count, runs[r].first);
+			stats.drew(mesh.count, runs[r].count);
+		}
+		return bytes;
+	}
+
+	void deleteBuffers() {
+		glDeleteBuffers(3, buffers);
+		glDeleteVertexArrays(1, &vao);
+	}
+};
+
+inline void CompactParseArgs(CompactParticles& compact, int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--compact") == 0) compact.enabled = true;
+	}
+}
+
+#endif
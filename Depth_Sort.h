@@ -0,0 +1,245 @@
+//Back to front ordering of the particles for alpha blending
+//Include after glm. sort() takes the indices to draw (e.g. the frustum's visible list) and fills order
+//with them sorted far to near by view depth. The demos write their instances in that order straight into
+//one batch of the render queue (RenderQueue::submitInstances), which draws it as it is. Depth is
+//quantized to 16 bits over the frame's depth range and sorted with an LSD radix sort, two 8 bit passes.
+//From parallelMin keys on, the histogram and scatter of each pass are split over worker threads, started
+//on the first parallel sort and kept for later frames.
+//Temporal coherence: last frame's order is the input sequence of this frame's sort. Particles seldom
+//swap places from one frame to the next, so that sequence is usually nearly sorted and an insertion
+//sort finishes it in about linear time instead of running the radix passes. What the insertion sort
+//costs is how far the particles have to move, not how many are out of place (one new particle appended
+//at the far end moves past all the others), so it gets a budget of insertionMoves per key and hands
+//over to the radix sort when that runs out. Both sorts are stable, so particles at equal depth also
+//keep last frame's order and don't flicker.
+//The demos erase dead particles from the middle of the arrays, so call remove() with the index of
+//every erased particle to keep last frame's order pointing at the right particles. The indices are only
+//collected there; the next sort() moves last frame's order past all of them in one pass.
+
+#ifndef DEPTH_SORT_H
+#define DEPTH_SORT_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+//Threads that stay asleep between jobs, so a sort doesn't start new ones every pass
+struct SortWorkers {
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake, finished;
+	void (*call)(void*, int) = 0; //the job, called as call(context, chunk)
+	void* context = 0;
+	int generation = 0, chunks = 0, pending = 0;
+	bool quit = false;
+
+	template <class Fn>
+	static void trampoline(void* fn, int chunk) { (*(Fn*)fn)(chunk); }
+
+	void loop(int chunk) {
+		int seen = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			wake.wait(lock, [&] { return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+			if (chunk >= chunks) continue; //this job uses fewer threads
+			lock.unlock();
+			call(context, chunk);
+			lock.lock();
+			if (--pending == 0) finished.notify_one();
+		}
+	}
+
+	//Runs fn(chunk) for chunks 0..n-1, chunk 0 on the calling thread
+	template <class Fn>
+	void run(int n, Fn& fn) {
+		if (n <= 1) {
+			fn(0);
+			return;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		while ((int)threads.size() < n - 1) threads.push_back(std::thread(&SortWorkers::loop, this, (int)threads.size() + 1));
+		call = &trampoline<Fn>;
+		context = &fn;
+		chunks = n;
+		pending = n - 1;
+		generation++;
+		lock.unlock();
+		wake.notify_all();
+		fn(0);
+		lock.lock();
+		finished.wait(lock, [&] { return pending == 0; });
+	}
+
+	~SortWorkers() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+		for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+	}
+};
+
+struct DepthSort {
+	std::vector<int> order;        //result, far to near
+	size_t parallelMin = 16384;    //fewer keys are sorted on the calling thread
+	int threads = 0;               //0 = hardware concurrency, at most maxThreads
+	static const int maxThreads = 8;
+	size_t insertionMoves = 8;     //insertion sort budget per key before the radix sort takes over
+	SortWorkers workers;
+
+	std::vector<int> previous;     //last frame's order
+	std::vector<uint16_t> keyOf;   //by particle index, 0 = farthest
+	std::vector<float> depthOf;    //by particle index
+	std::vector<unsigned char> state; //by particle index: 1 = to draw, 2 = already in the input sequence
+	std::vector<int> tmpOrder;
+	std::vector<int> removed;      //erased since the last remap(), as remove() got them
+	std::vector<int> newIndex;     //by index before the erases, -1 = erased
+	std::vector<uint16_t> keys, tmpKeys;
+	size_t histogram[maxThreads][256];
+
+	//The particle at index was erased, later particles moved down by one
+	void remove(int index) {
+		if (!removed.empty() && index < removed.back()) remap(); //a new pass over the arrays
+		removed.push_back(index);
+	}
+
+	//Applies the erases to last frame's order. They came in increasing order of the index at the time,
+	//so the k-th was index + k before any of them.
+	void remap() {
+		if (removed.empty()) return;
+		int n = 0;
+		for (size_t k = 0; k < previous.size(); k++) n = std::max(n, previous[k] + 1);
+		newIndex.resize(n);
+		size_t k = 0;
+		for (int p = 0; p < n; p++) {
+			while (k < removed.size() && removed[k] + (int)k < p) k++;
+			newIndex[p] = k < removed.size() && removed[k] + (int)k == p ? -1 : p - (int)k;
+		}
+		size_t w = 0;
+		for (size_t i = 0; i < previous.size(); i++) {
+			if (newIndex[previous[i]] >= 0) previous[w++] = newIndex[previous[i]];
+		}
+		previous.resize(w);
+		removed.clear();
+	}
+
+	template <class Vector>
+	void sort(const Vector& position, const std::vector<int>& draw, const glm::mat4& view) {
+		size_t count = position.size();
+		order.clear();
+		remap();
+		if (draw.empty()) {
+			previous.clear();
+			return;
+		}
+		depthOf.resize(count);
+		keyOf.resize(count);
+		state.assign(count, 0);
+
+		//distance along the view direction, the camera looks down -z in view space
+		float minDepth = 1e30f, maxDepth = -1e30f;
+		for (size_t k = 0; k < draw.size(); k++) {
+			const glm::vec3& p = position[draw[k]];
+			float d = -(view[0][2] * p.x + view[1][2] * p.y + view[2][2] * p.z + view[3][2]);
+			depthOf[draw[k]] = d;
+			if (d < minDepth) minDepth = d;
+			if (d > maxDepth) maxDepth = d;
+			state[draw[k]] = 1;
+		}
+		float scale = maxDepth > minDepth ? 65535.0f / (maxDepth - minDepth) : 0.0f;
+		for (size_t k = 0; k < draw.size(); k++) {
+			keyOf[draw[k]] = (uint16_t)((maxDepth - depthOf[draw[k]]) * scale);
+		}
+
+		//last frame's order first, then whatever is new this frame
+		for (size_t k = 0; k < previous.size(); k++) {
+			int p = previous[k];
+			if (p < (int)count && state[p] == 1) {
+				order.push_back(p);
+				state[p] = 2;
+			}
+		}
+		for (size_t k = 0; k < draw.size(); k++) {
+			if (state[draw[k]] == 1) order.push_back(draw[k]);
+		}
+
+		if (!insertionSort()) radixSort();
+		previous = order;
+	}
+
+	//False if it ran out of moves, order is then still a permutation (partly sorted) for the radix sort
+	bool insertionSort() {
+		size_t budget = insertionMoves * order.size();
+		for (size_t k = 1; k < order.size(); k++) {
+			int p = order[k];
+			uint16_t key = keyOf[p];
+			size_t j = k;
+			while (j > 0 && keyOf[order[j - 1]] > key) {
+				order[j] = order[j - 1];
+				j--;
+			}
+			order[j] = p;
+			if (k - j > budget) return false;
+			budget -= k - j;
+		}
+		return true;
+	}
+
+	void radixSort() {
+		size_t n = order.size();
+		keys.resize(n);
+		tmpKeys.resize(n);
+		tmpOrder.resize(n);
+		for (size_t k = 0; k < n; k++) keys[k] = keyOf[order[k]];
+
+		int numThreads = 1;
+		if (n >= parallelMin) {
+			numThreads = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+			if (numThreads < 1) numThreads = 1;
+			if (numThreads > maxThreads) numThreads = maxThreads;
+		}
+		size_t chunk = (n + numThreads - 1) / numThreads;
+
+		for (int shift = 0; shift < 16; shift += 8) {
+			//count the digits of each chunk
+			auto count = [&](int t) {
+				size_t* h = histogram[t];
+				for (int d = 0; d < 256; d++) h[d] = 0;
+				size_t end = std::min(n, (t + 1) * chunk);
+				for (size_t k = t * chunk; k < end; k++) h[(keys[k] >> shift) & 0xff]++;
+			};
+			workers.run(numThreads, count);
+
+			//turn the counts into where each chunk writes each digit, chunks in order keep it stable
+			size_t offset = 0;
+			for (int d = 0; d < 256; d++) {
+				for (int t = 0; t < numThreads; t++) {
+					size_t c = histogram[t][d];
+					histogram[t][d] = offset;
+					offset += c;
+				}
+			}
+
+			auto scatter = [&](int t) {
+				size_t* h = histogram[t];
+				size_t end = std::min(n, (t + 1) * chunk);
+				for (size_t k = t * chunk; k < end; k++) {
+					size_t dst = h[(keys[k] >> shift) & 0xff]++;
+					tmpKeys[dst] = keys[k];
+					tmpOrder[dst] = order[k];
+				}
+			};
+			workers.run(numThreads, scatter);
+			keys.swap(tmpKeys);
+			order.swap(tmpOrder);
+		}
+	}
+};
+
+#endif
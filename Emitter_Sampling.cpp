@@ -0,0 +1,144 @@
+//Sampling check of the emitter shapes in Emitter_Shapes.h
+//  g++ -O2 Emitter_Sampling.cpp -o Emitter_Sampling      (with the glad folder next to it, for Mesh_Arena.h)
+//  ./Emitter_Sampling [--samples 200000] [--mesh sphere.txt]
+
+//Draws samples from every shape through Emit() and checks them: no NaNs, every sample inside the shape,
+//and the fraction of samples in a part of it that a uniform sampler fills to a known share (a disk's
+//samples inside radius / sqrt(2) are half of them, a ball's inside radius / cbrt(2) too, ...). It also
+//runs the mesh surface shape on a mesh file, on two triangles of area 1 and 3 (a quarter of the samples
+//on the first) and on meshes without area or triangles. Prints samples per second per shape and exits
+//non zero if a check fails.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <vector>
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include "Mesh_Arena.h"
+#include "Emitter_Shapes.h"
+
+using namespace std;
+
+static double now() {
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int failures = 0;
+
+//inside(p) says if a sample is in the shape, part(p) if it is in the part that should get the expected
+//share of them
+template <class Shape, class Inside, class Part>
+void check(const char* name, const Shape& shape, int samples, Inside inside, Part part, float expected = 0.5f) {
+	EmitRng rng(5611);
+	vector<glm::vec3> out;
+	out.reserve(samples);
+	double start = now();
+	Emit(shape, samples, out, rng);
+	double seconds = now() - start;
+	int nans = 0, outside = 0, inPart = 0;
+	for (int i = 0; i < samples; i++) {
+		const glm::vec3& p = out[i];
+		if (std::isnan(p.x) || std::isnan(p.y) || std::isnan(p.z)) nans++;
+		else if (!inside(p)) outside++;
+		if (part(p)) inPart++;
+	}
+	float fraction = (float)inPart / samples;
+	bool ok = nans == 0 && outside == 0 && fabs(fraction - expected) < 0.01f;
+	if (!ok) failures++;
+	printf("%-16s %10.3e %8d %8d %8.4f/%.2f  %s\n", name, samples / seconds, nans, outside, fraction, expected, ok ? "ok" : "FAIL");
+}
+
+static bool near(float a, float b) { return fabs(a - b) <= 2e-3f * (1 + fabs(b)); } //EmitSinCos is about 1e-3 off
+static bool same(const glm::vec3& a, const glm::vec3& b) { return glm::length(a - b) <= 1e-5f * (1 + glm::length(b)); } //up to rounding
+
+//A mesh as the arena stores it, from triangle corners
+static vector<float> vertices(const vector<glm::vec3>& corners) {
+	vector<float> v;
+	for (size_t i = 0; i < corners.size(); i++) {
+		float f[MESH_VERTEX_FLOATS] = { corners[i].x, corners[i].y, corners[i].z };
+		v.insert(v.end(), f, f + MESH_VERTEX_FLOATS);
+	}
+	return v;
+}
+
+int main(int argc, char* argv[]) {
+	int samples = 200000;
+	const char* meshFile = "sphere.txt";
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--samples") == 0) samples = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--mesh") == 0) meshFile = argv[++i];
+	}
+
+	const glm::vec3 c(1.0f, -2.0f, 0.5f);
+	const float R = 1.5f;
+	printf("%-16s %10s %8s %8s %13s\n", "shape", "samples/s", "NaNs", "outside", "part/expected");
+
+	check("point", PointShape(c), samples,
+		[&](const glm::vec3& p) { return p == c; },
+		[&](const glm::vec3&) { return true; }, 1.0f);
+	glm::vec3 h(1.0f, 2.0f, 0.5f);
+	check("box", BoxShape(c, h), samples,
+		[&](const glm::vec3& p) { return fabs(p.x - c.x) <= h.x && fabs(p.y - c.y) <= h.y && fabs(p.z - c.z) <= h.z; },
+		[&](const glm::vec3& p) { return p.x < c.x; });
+	check("disk", DiskShape(c, R), samples,
+		[&](const glm::vec3& p) { return p.z == c.z && glm::length(p - c) <= R * 1.002f; },
+		[&](const glm::vec3& p) { return glm::length(p - c) < R / sqrt(2.0f); });
+	check("hemisphere", HemisphereShape(c, R), samples,
+		[&](const glm::vec3& p) { return p.z <= c.z && near(glm::length(p - c), R); },
+		[&](const glm::vec3& p) { glm::vec3 d = p - c; return d.x * d.x + d.y * d.y < R * R / 2; });
+	check("sphere surface", SphereSurfaceShape(c, R), samples,
+		[&](const glm::vec3& p) { return near(glm::length(p - c), R); },
+		[&](const glm::vec3& p) { return p.z > c.z; });
+	check("sphere volume", SphereVolumeShape(c, R), samples,
+		[&](const glm::vec3& p) { return glm::length(p - c) <= R * 1.002f; },
+		[&](const glm::vec3& p) { return glm::length(p - c) < R / cbrt(2.0f); });
+	const float halfAngle = 0.4f, cosHalf = cos(halfAngle);
+	check("cone", ConeShape(c, halfAngle, 2.0f, 3.0f), samples,
+		[&](const glm::vec3& p) { float l = glm::length(p - c); return l >= 2.0f * 0.998f && l <= 3.0f * 1.002f && (p.z - c.z) / l >= cosHalf - 2e-3f; },
+		[&](const glm::vec3& p) { return (p.z - c.z) / glm::length(p - c) > (1 + cosHalf) / 2; }); //uniform on the cap: half above its mid height
+
+	//two triangles, area 1 at z = 0 and area 3 at z = 1
+	vector<glm::vec3> corners;
+	corners.push_back(glm::vec3(0, 0, 0)); corners.push_back(glm::vec3(2, 0, 0)); corners.push_back(glm::vec3(0, 1, 0));
+	corners.push_back(glm::vec3(0, 0, 1)); corners.push_back(glm::vec3(3, 0, 1)); corners.push_back(glm::vec3(0, 2, 1));
+	vector<float> two = vertices(corners);
+	MeshRange range = { 0, 0, 6 };
+	check("mesh by area", MeshSurfaceShape(two, range), samples,
+		[&](const glm::vec3& p) {
+			if (fabs(p.z) < 1e-5f) return p.x >= -1e-5f && p.y >= -1e-5f && p.x / 2 + p.y <= 1.0001f;
+			return fabs(p.z - 1) < 1e-5f && p.x >= -1e-5f && p.y >= -1e-5f && p.x / 3 + p.y / 2 <= 1.0001f;
+		},
+		[&](const glm::vec3& p) { return p.z < 0.5f; }, 0.25f);
+
+	//no area and no triangles: no NaNs, every sample on the collapsed mesh
+	vector<glm::vec3> flat(3, glm::vec3(4, 5, 6));
+	vector<float> degenerate = vertices(flat);
+	MeshRange one = { 0, 0, 3 }, none = { 0, 0, 0 };
+	check("mesh no area", MeshSurfaceShape(degenerate, one), samples,
+		[&](const glm::vec3& p) { return same(p, glm::vec3(4, 5, 6)); },
+		[&](const glm::vec3&) { return true; }, 1.0f);
+	check("mesh empty", MeshSurfaceShape(degenerate, none, c), samples,
+		[&](const glm::vec3& p) { return same(p, c); },
+		[&](const glm::vec3&) { return true; }, 1.0f);
+
+	//a real mesh through the arena: every sample within the mesh's bounding sphere
+	MeshArena arena;
+	int mesh = arena.addMesh(meshFile);
+	if (mesh >= 0) {
+		float reach = 0;
+		for (size_t v = 0; v < arena.vertices.size(); v += MESH_VERTEX_FLOATS) {
+			reach = std::max(reach, glm::length(glm::vec3(arena.vertices[v], arena.vertices[v + 1], arena.vertices[v + 2])));
+		}
+		check(meshFile, MeshSurfaceShape(arena.vertices, arena.mesh(mesh)), samples,
+			[&](const glm::vec3& p) { return glm::length(p) <= reach * 1.0001f; },
+			[&](const glm::vec3& p) { return p.z > 0; }); //a mesh symmetric about z = 0 like the sphere
+	}
+	else failures++;
+
+	printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+//Emitter shapes: where new particles start (or which way they fly), sampled in bulk
+//Include after glm and Mesh_Arena.h. A shape is a small struct with DIMS, the uniform numbers one sample takes, and
+//sample(u) mapping them to a point without rejection or branches, so every sample costs the same and
+//nothing comes out NaN. Emit() is templated on the shape: it fills the uniforms for the whole batch from
+//a 4 lane xorshift, then runs one tight loop of shape.sample() appending to the particle array, with the
+//shape's code inlined into it so the compiler can vectorize it.
+//  EmitRng rng(rand());                              //once, after srand
+//  Emit(DiskShape(center, radius), n, position, rng);
+//  Emit(SphereSurfaceShape(glm::vec3(0.0f), speed), n, velocity, rng);
+//Shapes that lie in a plane are in the xy plane, "up" is +z like in the demos.
+//Emitter_Sampling.cpp checks every shape's samples for NaNs, bounds and uniformity.
+
+#ifndef EMITTER_SHAPES_H
+#define EMITTER_SHAPES_H
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+
+//sin and cos of 2*pi*turns for turns in [0,1), polynomial and branch free, about 1e-3 off
+inline void EmitSinCos(float turns, float& s, float& c) {
+	float x = turns - (float)(int)(turns + 0.5f); //[-0.5,0.5], the casts truncate positive numbers only
+	float y = x + 0.25f;
+	y = y - (float)(int)(y + 0.5f);
+	s = 8.0f * x - 16.0f * x * std::fabs(x);     //parabolas through the extremes and zeros
+	c = 8.0f * y - 16.0f * y * std::fabs(y);
+	s = 0.225f * (s * std::fabs(s) - s) + s;     //corrected towards the sine
+	c = 0.225f * (c * std::fabs(c) - c) + c;
+}
+
+//4 independent xorshift32 streams, one per lane, so fill() vectorizes
+struct EmitRng {
+	uint32_t state[4];
+
+	explicit EmitRng(uint32_t seed = 1) {
+		for (int k = 0; k < 4; k++) {
+			seed = seed * 1664525u + 1013904223u;
+			state[k] = seed | 1; //never 0
+		}
+	}
+
+	//n uniform floats in [0,1)
+	void fill(float* u, int n) {
+		int i = 0;
+		for (; i + 4 <= n; i += 4) {
+			for (int k = 0; k < 4; k++) {
+				uint32_t x = state[k];
+				x ^= x << 13;
+				x ^= x >> 17;
+				x ^= x << 5;
+				state[k] = x;
+				u[i + k] = (x >> 8) * (1.0f / 16777216.0f);
+			}
+		}
+		float rest[4];
+		if (i < n) {
+			fill(rest, 4);
+			for (int k = 0; k < n - i; k++) u[i + k] = rest[k];
+		}
+	}
+};
+
+struct PointShape {
+	enum { DIMS = 1 }; //none needed, 1 keeps the uniform buffer non empty
+	glm::vec3 center;
+	explicit PointShape(const glm::vec3& c) : center(c) {}
+	glm::vec3 sample(const float*) const { return center; }
+};
+
+//Uniform on an axis aligned box
+struct BoxShape {
+	enum { DIMS = 3 };
+	glm::vec3 center, halfSize;
+	BoxShape(const glm::vec3& c, const glm::vec3& h) : center(c), halfSize(h) {}
+	glm::vec3 sample(const float* u) const {
+		return center + halfSize * glm::vec3(2 * u[0] - 1, 2 * u[1] - 1, 2 * u[2] - 1);
+	}
+};
+
+//Uniform on a disk in the xy plane
+struct DiskShape {
+	enum { DIMS = 2 };
+	glm::vec3 center;
+	float radius;
+	DiskShape(const glm::vec3& c, float r) : center(c), radius(r) {}
+	glm::vec3 sample(const float* u) const {
+		float s, c;
+		EmitSinCos(u[1], s, c);
+		float r = radius * std::sqrt(u[0]);
+		return center + glm::vec3(r * c, r * s, 0.0f);
+	}
+};
+
+//The lower half sphere straight below a uniform point of its disk, the bowl the fire starts on (Fire_Simulation.cpp).
+//Denser towards the rim than a uniform surface sample.
+struct HemisphereShape {
+	enum { DIMS = 2 };
+	glm::vec3 center;
+	float radius;
+	HemisphereShape(const glm::vec3& c, float r) : center(c), radius(r) {}
+	glm::vec3 sample(const float* u) const {
+		float s, c;
+		EmitSinCos(u[1], s, c);
+		float r2 = radius * radius * u[0]; //squared distance from the axis
+		float r = std::sqrt(r2);
+		return center + glm::vec3(r * c, r * s, -std::sqrt(std::max(radius * radius - r2, 0.0f)));
+	}
+};
+
+//Uniform on a sphere (Archimedes: the height is uniform), also a uniform direction times a speed
+struct SphereSurfaceShape {
+	enum { DIMS = 2 };
+	glm::vec3 center;
+	float radius;
+	SphereSurfaceShape(const glm::vec3& c, float r) : center(c), radius(r) {}
+	glm::vec3 sample(const float* u) const {
+		float s, c;
+		EmitSinCos(u[1], s, c);
+		float z = 1 - 2 * u[0];
+		float r = std::sqrt(std::max(1 - z * z, 0.0f));
+		return center + radius * glm::vec3(r * c, r * s, z);
+	}
+};
+
+//Uniform in a ball
+struct SphereVolumeShape {
+	enum { DIMS = 3 };
+	glm::vec3 center;
+	float radius;
+	SphereVolumeShape(const glm::vec3& c, float r) : center(c), radius(r) {}
+	glm::vec3 sample(const float* u) const {
+		return SphereSurfaceShape(center, radius * std::cbrt(u[2])).sample(u);
+	}
+};
+
+//Uniform directions within halfAngle of +z, with lengths uniform in [minLength,maxLength], for sprays
+struct ConeShape {
+	enum { DIMS = 3 };
+	glm::vec3 apex;
+	float cosHalfAngle, minLength, maxLength;
+	ConeShape(const glm::vec3& a, float halfAngle, float minLen, float maxLen)
+		: apex(a), cosHalfAngle(std::cos(halfAngle)), minLength(minLen), maxLength(maxLen) {}
+	glm::vec3 sample(const float* u) const {
+		float s, c;
+		EmitSinCos(u[1], s, c);
+		float z = 1 - u[0] * (1 - cosHalfAngle); //uniform height on the unit sphere's cap
+		float r = std::sqrt(std::max(1 - z * z, 0.0f));
+		return apex + (minLength + u[2] * (maxLength - minLength)) * glm::vec3(r * c, r * s, z);
+	}
+};
+
+//Uniform on the triangles of a mesh, picked by area. Built from the MeshArena's vertices (so before its
+//upload()), moved by offset and scaled by scale like the demos draw their meshes. A mesh without area
+//picks its triangles evenly and one without triangles only gives offset.
+struct MeshSurfaceShape {
+	enum { DIMS = 3 };
+	std::vector<glm::vec3> corners; //3 per triangle
+	std::vector<float> cdf;         //running area, normalized to end at 1
+
+	template <class Range>
+	MeshSurfaceShape(const std::vector<float>& vertices, const Range& mesh, const glm::vec3& offset = glm::vec3(0.0f), float scale = 1.0f) {
+		float total = 0;
+		for (int v = 0; v + 3 <= mesh.count; v += 3) {
+			glm::vec3 p[3];
+			for (int k = 0; k < 3; k++) {
+				const float* f = &vertices[(mesh.first + v + k) * MESH_VERTEX_FLOATS];
+				p[k] = offset + scale * glm::vec3(f[0], f[1], f[2]);
+				corners.push_back(p[k]);
+			}
+			total += 0.5f * glm::length(glm::cross(p[1] - p[0], p[2] - p[0]));
+			cdf.push_back(total);
+		}
+		if (cdf.empty()) { //a single triangle collapsed to the offset
+			corners.assign(3, offset);
+			cdf.push_back(1.0f);
+		}
+		for (size_t t = 0; t < cdf.size(); t++) cdf[t] = total > 0 ? cdf[t] / total : (t + 1.0f) / cdf.size();
+	}
+
+	glm::vec3 sample(const float* u) const {
+		int t = std::upper_bound(cdf.begin(), cdf.end() - 1, u[0]) - cdf.begin(); //the last one catches round off
+		float root = std::sqrt(u[1]);
+		const glm::vec3* p = &corners[3 * t];
+		return p[0] * (1 - root) + p[1] * (root * (1 - u[2])) + p[2] * (root * u[2]);
+	}
+};
+
+//Appends n samples of shape to out
+template <class Shape, class Vector>
+void Emit(const Shape& shape, int n, Vector& out, EmitRng& rng) {
+	if (n <= 0) return;
+	static std::vector<float> uniforms; //kept, so a steady emission rate doesn't allocate
+	uniforms.resize((size_t)n * Shape::DIMS);
+	rng.fill(uniforms.data(), n * Shape::DIMS);
+	size_t start = out.size();
+	out.resize(start + n);
+	const float* u = uniforms.data();
+	for (int i = 0; i < n; i++) out[start + i] = shape.sample(u + i * Shape::DIMS);
+}
+
+#endif
@@ -19,6 +19,7 @@
 //  g++ Bounce.cpp glad/glad.c -lGL -lSDL; ./a.out
 
 #include "glad/glad.h"  //Include order can matter here
+#include "GL_Trace.h"  //build with -DGL_TRACE to count GL calls per frame
 #ifndef _WIN32
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengl.h>
@@ -38,6 +39,20 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/gtx/rotate_vector.hpp"
+#include "Benchmark.h"
+#include "Stats_Overlay.h"
+#include "Perf_Counters.h"
+#include "Alloc_Tracker.h" //build with -DTRACK_ALLOCS to count heap allocations per frame
+#include "Shader_Manager.h"
+#include "Render_Queue.h"
+#include "Frustum_Cull.h"
+#include "Depth_Sort.h"
+#include "Weighted_OIT.h"
+#include "Low_Res_Particles.h"
+#include "Overdraw_Heatmap.h"
+#include "Color_Gradient.h"
+#include "Region_Grid.h"
+#include "Emitter_Shapes.h"
 
 #include <fstream>
 using namespace std;
@@ -47,67 +62,50 @@ int screen_width = 800;
 int screen_height = 600;
 
 //changed 02/03/2018
-vector<glm::vec3>position;
-vector<glm::vec3>velocity;
-vector<glm::vec3>color;
-vector<float>lifespan;
+ParticleVector<glm::vec3>position;
+ParticleVector<glm::vec3>velocity;
+ParticleVector<unsigned char>flameRow; //gradient of the flame region the particle was last in
+ParticleVector<float>lifespan;
+ParticleVector<unsigned char>region; //flame region of every particle this frame, from flameGrid
 float radius = 0.02;
 float floorPos = -1.2;
 
-// Shader sources
-const GLchar* vertexSource =
-"#version 150 core\n"
-"in vec3 position;"
-//"in vec3 inColor;"
-//the color will be changed in the OpenGL part
-//change the number of particles
-"uniform vec3 inColor;"
-"in vec3 inNormal;"
-"const vec3 inLightDir = normalize(vec3(0,2,2));"
-"out vec3 Color;"
-"out vec3 normal;"
-"out vec3 lightDir;"
-"uniform mat4 model;"
-"uniform mat4 view;"
-"uniform mat4 proj;"
-"void main() {"
-"   Color = inColor;"
-"   gl_Position = proj * view * model * vec4(position, 1.0);"
-"   vec4 norm4 = transpose(inverse(model)) * vec4(inNormal, 1.0);"
-"   normal = normalize(norm4.xyz);"
-"   lightDir = (view * vec4(inLightDir, 0)).xyz;"
-"}";
-
-const GLchar* fragmentSource =
-"#version 150 core\n"
-"in vec3 Color;"
-"in vec3 normal;"
-"in vec3 lightDir;"
-"out vec4 outColor;"
-"const float ambient = .2;"
-"void main() {"
-"   vec3 diffuseC = Color * max(dot(lightDir, normal), 0);"
-"   vec3 ambC = Color * ambient;"
-// the alpha channel of all pixels are 1.0, i.e. the opacity is 100%
-"   outColor = vec4(diffuseC+ambC, 1.0);"
-"}";
+//flame regions, baked into flameGrid once
+#define FLAME_OUTSIDE 0 //out of the cone, the particle dies
+#define FLAME_CONE 1    //in the cone, keeps its color
+#define FLAME_MIDDLE 2
+#define FLAME_CORE 3
 
 bool fullscreen = false;
 void Win2PPM(int width, int height);
-void computePhysics(int i, float dt);
+bool computePhysics(int i, float dt);
 bool IsInHemisphere(glm::vec3 point, glm::vec3 center, float radius);
 bool IsUnderCone(glm::vec3 point, float radius, float height);
 float randf();
-bool DEBUG_ON = true;
-GLuint InitShader(const char* vShaderFileName, const char* fShaderFileName);
-
-//Index of where to model, view, and projection matricies are stored on the GPU
-GLint uniModel, uniView, uniProj, uniColor;
 
 float aspect; //aspect ratio (needs to be updated if the window is resized)
 
+Benchmark bench; //enabled with --benchmark, see Benchmark.h
+ParticleStats stats; //per frame counters, see Particle_Stats.h
+StatsOverlay overlay;
+PerfCounters perf; //--perf, hardware counters per frame phase
+RenderQueue queue; //draws sorted by state, see Render_Queue.h
+Frustum frustum; //particles outside the view are not drawn
+DepthSort depthSort; //back to front order for blending
+WeightedOIT oit; //--oit, blending without the sort, see Weighted_OIT.h
+LowResParticles lowRes; //--lowres 2|4, particles at reduced resolution
+OverdrawHeatmap heatmap; //--overdraw, fragments per pixel of the particle pass
+ColorGradients gradients; //color over the particles' age for every flame region
+RegionGrid flameGrid; //which part of the flame a point is in, one lookup instead of three shape tests
+
 int main(int argc, char *argv[]) {
 	SDL_Init(SDL_INIT_VIDEO);  //Initialize Graphics (for OpenGL)
+	StatsParseArgs(stats, argc, argv);
+	OverdrawParseArgs(heatmap, argc, argv);
+	LowResParseArgs(lowRes, argc, argv);
+	OITParseArgs(oit, argc, argv);
+	PerfParseArgs(perf, argc, argv);
+	BenchmarkParseArgs(bench, "fire", argc, argv);
 
 	//Ask SDL to get a recent version of OpenGL (3.2 or greater)
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -115,7 +113,7 @@ int main(int argc, char *argv[]) {
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 4);
 
 	//Create a window (offsetx, offsety, width, height, flags)
-	SDL_Window* window = SDL_CreateWindow("My OpenGL Program", 150, 50, screen_width, screen_height, SDL_WINDOW_OPENGL);
+	SDL_Window* window = SDL_CreateWindow("My OpenGL Program", 150, 50, screen_width, screen_height, SDL_WINDOW_OPENGL | (bench.enabled ? SDL_WINDOW_HIDDEN : 0));
 	aspect = screen_width / (float)screen_height; //aspect ratio (needs to be updated if the window is resized)
 
 	//The above window cannot be resized which makes some code slightly easier.
@@ -137,188 +135,45 @@ int main(int argc, char *argv[]) {
 		printf("ERROR: Failed to initialize OpenGL context.\n");
 		return -1;
 	}
-
-	//Build a Vertex Array Object. This stores the VBO and attribute mappings in one object
-	GLuint vao;
-	glGenVertexArrays(1, &vao); //Create a VAO
-	glBindVertexArray(vao); //Bind the above created VAO to the current context
-
-	ifstream modelFile;
-	modelFile.open("sphere.txt");
-	int numLines = 0;
-	modelFile >> numLines;
-	float *vertices = new float[numLines];
-	for (int i = 0; i < numLines; i++) {
-		modelFile >> vertices[i];
-	}
-	printf("wall numLines: %d\n", numLines);
-	int numVerts = numLines / 8;
-	modelFile.close();
-
-	//Allocate memory on the graphics card to store geometry (vertex buffer object)
-	GLuint vbo;
-	glGenBuffers(1, &vbo);  //Create 1 buffer called vbo
-	glBindBuffer(GL_ARRAY_BUFFER, vbo); //Set the vbo as the active array buffer (Only one buffer can be active at a time)
-	glBufferData(GL_ARRAY_BUFFER, numLines * sizeof(float), vertices, GL_STATIC_DRAW); //upload vertices to vbo
-	//GL_STATIC_DRAW means we won't change the geometry, GL_DYNAMIC_DRAW = geometry changes infrequently
-	//GL_STREAM_DRAW = geom. changes frequently.  This effects which types of GPU memory is used
-
-	//Load the vertex Shader
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexSource, NULL);
-	glCompileShader(vertexShader);
-
-	//Let's double check the shader compiled 
-	GLint status;
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-	if (!status) {
-		char buffer[512];
-		glGetShaderInfoLog(vertexShader, 512, NULL, buffer);
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
-			"Compilation Error",
-			"Failed to Compile: Check Consol Output.",
-			NULL);
-		printf("Vertex Shader Compile Failed. Info:\n\n%s\n", buffer);
-	}
-
-	//Load the fragment Shader
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-	glCompileShader(fragmentShader);
-
-	//Double check the shader compiled 
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-	if (!status) {
-		char buffer[512];
-		glGetShaderInfoLog(fragmentShader, 512, NULL, buffer);
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
-			"Compilation Error",
-			"Failed to Compile: Check Consol Output.",
-			NULL);
-		printf("Fragment Shader Compile Failed. Info:\n\n%s\n", buffer);
-	}
-
-	//Join the vertex and fragment shaders together into one program
-	GLuint shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	glBindFragDataLocation(shaderProgram, 0, "outColor"); // set output
-	glLinkProgram(shaderProgram); //run the linker
-
-	glUseProgram(shaderProgram); //Set the active shader (only one can be used at a time)
-
-	//Tell OpenGL how to set fragment shader input 
-	GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-	glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
-	//Attribute, vals/attrib., type, normalized?, stride, offset
-	//Binds to VBO current GL_ARRAY_BUFFER 
-	glEnableVertexAttribArray(posAttrib);
-
-	/*GLint colAttrib = glGetAttribLocation(shaderProgram, "inColor");
-	glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(colAttrib);*/
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	GLint normAttrib = glGetAttribLocation(shaderProgram, "inNormal");
-	glVertexAttribPointer(normAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
-	glEnableVertexAttribArray(normAttrib);
-
-	glBindVertexArray(0); //Unbind the VAO
-
-	//=================
-	//|| load candle ||
-	//=================
-
-	//Build a Vertex Array Object. This stores the VBO and attribute mappings in one object
-	GLuint vao1;
-	glGenVertexArrays(1, &vao1); //Create a VAO
-	glBindVertexArray(vao1); //Bind the above created VAO to the current context
-
-	modelFile.open("candle.txt");
-	numLines = 0;
-	modelFile >> numLines;
-	float *vertices_candle = new float[numLines];
-	for (int i = 0; i < numLines; i++) {
-		modelFile >> vertices_candle[i];
-	}
-	printf("wall numLines: %d\n", numLines);
-	int numVerts_candle = numLines / 8;
-	modelFile.close();
-
-	//Allocate memory on the graphics card to store geometry (vertex buffer object)
-	GLuint vbo1;
-	glGenBuffers(1, &vbo1);  //Create 1 buffer called vbo
-	glBindBuffer(GL_ARRAY_BUFFER, vbo1); //Set the vbo as the active array buffer (Only one buffer can be active at a time)
-	glBufferData(GL_ARRAY_BUFFER, numLines * sizeof(float), vertices_candle, GL_STATIC_DRAW); //upload vertices_candle to vbo															   
-
-	//Load the vertex Shader
-	GLuint vertexShader1 = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader1, 1, &vertexSource, NULL);
-	glCompileShader(vertexShader1);
-
-	//Let's double check the shader compiled 
-	GLint status1;
-	glGetShaderiv(vertexShader1, GL_COMPILE_STATUS, &status1);
-	if (!status) {
-		char buffer[512];
-		glGetShaderInfoLog(vertexShader, 512, NULL, buffer);
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
-			"Compilation Error",
-			"Failed to Compile: Check Consol Output.",
-			NULL);
-		printf("Vertex Shader Compile Failed. Info:\n\n%s\n", buffer);
-	}
-
-	//Load the fragment Shader
-	GLuint fragmentShader1 = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader1, 1, &fragmentSource, NULL);
-	glCompileShader(fragmentShader1);
-
-	//Double check the shader compiled 
-	glGetShaderiv(fragmentShader1, GL_COMPILE_STATUS, &status1);
-	if (!status) {
-		char buffer[512];
-		glGetShaderInfoLog(fragmentShader, 512, NULL, buffer);
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
-			"Compilation Error",
-			"Failed to Compile: Check Consol Output.",
-			NULL);
-		printf("Fragment Shader Compile Failed. Info:\n\n%s\n", buffer);
-	}
-
-	//Join the vertex and fragment shaders together into one program
-	GLuint shaderProgram1 = glCreateProgram();
-	glAttachShader(shaderProgram1, vertexShader1);
-	glAttachShader(shaderProgram1, fragmentShader1);
-	glBindFragDataLocation(shaderProgram1, 0, "outColor"); // set output
-	glLinkProgram(shaderProgram1); //run the linker
-
-	glUseProgram(shaderProgram1); //Set the active shader (only one can be used at a time)
-
-								 //Tell OpenGL how to set fragment shader input 
-	posAttrib = glGetAttribLocation(shaderProgram1, "position");
-	glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
-	//Attribute, vals/attrib., type, normalized?, stride, offset
-	//Binds to VBO current GL_ARRAY_BUFFER 
-	glEnableVertexAttribArray(posAttrib);
-
-	/*GLint colAttrib = glGetAttribLocation(shaderProgram, "inColor");
-	glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(colAttrib);*/
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo1);
-	normAttrib = glGetAttribLocation(shaderProgram1, "inNormal");
-	glVertexAttribPointer(normAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
-	glEnableVertexAttribArray(normAttrib);
-
-	glBindVertexArray(0); //Unbind the VAO
-
-
-	//Where to model, view, and projection matricies are stored on the GPU
-	uniModel = glGetUniformLocation(shaderProgram, "model");
-	uniView = glGetUniformLocation(shaderProgram, "view");
-	uniProj = glGetUniformLocation(shaderProgram, "proj");
-	uniColor = glGetUniformLocation(shaderProgram, "inColor");
+	if (bench.enabled) SDL_GL_SetSwapInterval(0); //don't wait for vsync while benchmarking
+	StatsOverlayInit(overlay);
+
+	//All meshes share one vertex buffer and VAO so the whole frame is one multi draw (see Mesh_Arena.h)
+	MeshArena arena;
+	int sphereMesh = arena.addMesh("sphere.txt");
+	int candleMesh = arena.addMesh("candle.txt");
+	if (sphereMesh < 0) return -1;
+	arena.upload();
+	MeshRange sphere = arena.mesh(sphereMesh);
+
+	//Load the shaders from vertex.glsl and fragment.glsl (or the binary cache, see Shader_Manager.h)
+	ShaderManager shaders;
+	GLuint shaderProgram = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED"); //meshes are only moved and scaled
+	GLuint flameProgram = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED\n#define GRADIENT"); //particles, colored by age
+	GLuint oitProgram = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED\n#define GRADIENT\n#define OIT");
+	oit.load(shaders);
+	lowRes.load(shaders);
+	heatmap.load(shaders);
+	shaders.finish();
+	heatmap.init(screen_width, screen_height);
+	oit.init(screen_width, screen_height);
+	lowRes.init(screen_width, screen_height);
+
+	//The queue looks up the uniforms and points every program at the shared camera buffer
+	queue.init(&arena);
+	queue.addProgram(shaderProgram);
+	queue.addProgram(flameProgram);
+	queue.addProgram(oitProgram);
+	queue.addProgram(heatmap.countProgram);
+
+	//new particles are red, in the core they go from white to yellow as they age, around it from yellow to red
+	GradientKey birthKeys[] = { {0.0f, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f)} };
+	GradientKey coreKeys[] = { {0.0f, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)}, {1.0f, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f)} };
+	GradientKey outerKeys[] = { {0.0f, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f)}, {1.0f, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f)} };
+	unsigned char birthGradient = gradients.add(birthKeys, 1);
+	unsigned char coreGradient = gradients.add(coreKeys, 2);
+	unsigned char outerGradient = gradients.add(outerKeys, 2);
+	gradients.upload();
 
 	glEnable(GL_DEPTH_TEST);
 	//modified 02/04/2018
@@ -329,7 +184,8 @@ int main(int argc, char *argv[]) {
 	SDL_Event windowEvent;
 	bool quit = false;
 
-	srand(time(NULL));
+	srand(bench.enabled ? bench.seed : time(NULL));
+	EmitRng rng(rand()); //for the emitter shapes, seeded here so benchmark runs repeat
 
 	//particle system start here
 	//generate the emitter shape
@@ -354,6 +210,17 @@ int main(int argc, char *argv[]) {
 	float r2 = 0.2f;
 	glm::vec3 c2 = glm::vec3(0.0f, 0.0f, r2-r3);
 
+	//the flame doesn't move, so the shape tests run once per cell of a 64^3 grid around it. Particles start
+	//on the lower half of the emitter sphere and only rise, so they never leave the grid while in the cone.
+	float margin = 0.02f;
+	flameGrid.bake(glm::vec3(-r3 - margin, -r3 - margin, -r3 - margin), glm::vec3(r3 + margin, r3 + margin, h3 + margin), 64, FLAME_OUTSIDE,
+		[&](const glm::vec3& p) -> unsigned char {
+			if (!IsUnderCone(p, r3, h3)) return FLAME_OUTSIDE;
+			if (IsInHemisphere(p, c1, r1)) return FLAME_CORE;
+			if (IsInHemisphere(p + radius, c2, r2)) return FLAME_MIDDLE;
+			return FLAME_CONE;
+		});
+
 	//set parameters for camera
 	float movestep = 0.1;
 	float anglestep = 0.1;
@@ -371,6 +238,12 @@ int main(int argc, char *argv[]) {
 				quit = true; ; //Exit event loop
 			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_f) //If "f" is pressed
 				fullscreen = !fullscreen;
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_i) //"i" shows the stats overlay
+				overlay.visible = !overlay.visible;
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_h) //"h" shows the overdraw heatmap
+				heatmap.enabled = heatmap.supported && !heatmap.enabled;
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_o) //"o" switches between sorting and weighted OIT
+				oit.enabled = oit.supported && !oit.enabled;
 			SDL_SetWindowFullscreen(window, fullscreen ? SDL_WINDOW_FULLSCREEN : 0); //Set to full screen
 
 			if ((windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_UP) || \
@@ -436,23 +309,17 @@ int main(int argc, char *argv[]) {
 		if (dt > .1) dt = .1; //Have some max dt
 		lastTime = SDL_GetTicks() / 1000.f;
 		if (saveOutput) dt += .07; //Fix framerate at 14 FPS
+		if (bench.enabled) dt = bench.dt; //fixed step so benchmark runs are comparable
 
 		glm::mat4 view = glm::lookAt(camera_position, look_point, up_vector);
-		GLint uniView = glGetUniformLocation(shaderProgram, "view");
-		glUniformMatrix4fv(uniView, 1, GL_FALSE, glm::value_ptr(view));
 
 		glm::mat4 proj = glm::perspective(3.14f / 4, aspect, 1.0f, 10.0f); //FOV, aspect, near, far
-		GLint uniProj = glGetUniformLocation(shaderProgram, "proj");
-		glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(proj));
-
-		//draw candle
-		glm::mat4 candle = glm::translate(candle, glm::vec3(0.0f,0.0f,-1.0f));
-		//candle = glm::scale(candle, glm::vec3(0.5));
-		glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(candle));
-		glBindVertexArray(vao1);
-		glDrawArrays(GL_TRIANGLES, 0, numVerts_candle); //(Primitives, Which VBO, Number of vertices)
-		glBindVertexArray(0);
+		queue.setCamera(view, proj);
+		frustum.update(proj * view);
+		stats.uploaded(2 * sizeof(glm::mat4));
 
+		bench.beginFrame();
+		perf.begin(PHASE_SIMULATE);
 
 		//Partical birthrate
 		float numParticles = PARTICLE_NUM * dt;
@@ -464,69 +331,108 @@ int main(int argc, char *argv[]) {
 			numParticles += 1;
 		}
 
-		//generate new particles
-		for (int i = 0; i < numParticles; i++) {
-			//choose random particle location
-			float x = -shape_radius + randf() * shape_radius * 2;
-			float y = -shape_radius + randf() * shape_radius * 2;
-			position.push_back(glm::vec3(x, y, -sqrt(shape_radius *shape_radius -x*x-y*y)));
-			//choose random particle velocity
-			velocity.push_back(glm::vec3(0.0f, 0.0f, randf()));
-			color.push_back(glm::vec3(1.0f, 0.0f, 0.0f));
-			lifespan.push_back(maxLifeSpan);
-		}
-
-		for (int i = 0; i < position.size(); i++) {
+		//generate new particles on the lower half of the emitter sphere, rising at up to 1
+		int born = numParticles;
+		Emit(HemisphereShape(ini_position, shape_radius), born, position, rng);
+		Emit(BoxShape(glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.0f, 0.0f, 0.5f)), born, velocity, rng);
+		flameRow.resize(flameRow.size() + born, birthGradient);
+		lifespan.resize(lifespan.size() + born, maxLifeSpan);
+		stats.born(born);
+
+		//update the particles, the ones leaving the flame or dying are removed before drawing
+		flameGrid.classify(position, region);
+		for (int i = 0, j = 0; i < position.size(); i++, j++) { //j indexes region, which isn't erased from
 			lifespan[i] -= dt;
-			if (IsInHemisphere(position[i],c1,r1)) {
-				color[i] = glm::vec3(1.0f, 1.0f, randf());
+			if (region[j] == FLAME_CORE) {
+				flameRow[i] = coreGradient;
 			}
-			else if (IsInHemisphere(position[i]+radius, c2, r2)) {
-				color[i] = glm::vec3(1.0f, randf(), 0.0f);
+			else if (region[j] == FLAME_MIDDLE) {
+				flameRow[i] = outerGradient;
 			}
 			
-			if(!IsUnderCone(position[i],r3,h3)){
+			if (region[j] == FLAME_OUTSIDE || lifespan[i] <= 0) {
 				position.erase(position.begin() + i);
 				velocity.erase(velocity.begin() + i);
-				color.erase(color.begin() + i);
+				flameRow.erase(flameRow.begin() + i);
 				lifespan.erase(lifespan.begin() + i);
+				stats.died();
+				depthSort.remove(i);
+				i--;
 				continue;
 			}
-			glm::vec3 inColor = color[i];
-			glUniform3f(uniColor, inColor.r, inColor.g, inColor.b);
-
-			glm::mat4 model(1.0f);
-			if (lifespan[i] <= 0) {// draw the "alive" particles
-				position.erase(position.begin() + i);
-				velocity.erase(velocity.begin() + i);
-				color.erase(color.begin() + i);
-				lifespan.erase(lifespan.begin() + i);
-			}
-			model = glm::translate(model, position[i]);
-			model = glm::scale(model, glm::vec3(radius));
-			glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
-			
-			computePhysics(i, dt);
+			if (computePhysics(i, dt)) i--;
+		}
+		bench.endSimulate(position.size());
+		perf.end(PHASE_SIMULATE);
+		perf.begin(PHASE_RENDER);
 
-			glBindVertexArray(vao);
-			glDrawArrays(GL_TRIANGLES, 0, numVerts); //(Primitives, Which VBO, Number of vertices)
+		//draw candle
+		if (candleMesh >= 0) {
+			queue.submit(shaderProgram, arena.mesh(candleMesh), glm::vec3(0.0f, 0.0f, -1.0f), 1.0f, glm::vec3(0.9f, 0.85f, 0.7f)); //wax
 		}
 
+		//draw the "alive" particles that can be on screen
+		stats.culled(frustum.cull(position, radius));
+		bool sorted = heatmap.enabled || !oit.enabled; //weighted OIT needs no order
+		if (sorted) depthSort.sort(position, frustum.visible, view); //far to near, the queue keeps this order
+		const std::vector<int>& order = sorted ? depthSort.order : frustum.visible;
+		GLuint particleProgram = flameProgram;
+		queue.flush(stats); //the opaque candle first, the blended particles are tested against its depth
+		if (heatmap.enabled) {
+			heatmap.begin(); //counts the sorted full resolution pass
+			particleProgram = heatmap.countProgram;
+		}
+		else if (oit.enabled) {
+			oit.begin(true);
+			particleProgram = oitProgram;
+		}
+		else if (lowRes.enabled) lowRes.begin(stats);
+		ArenaInstance* instance = queue.submitInstances(particleProgram, sphere, order.size(), gradients.tex);
+		for (size_t v = 0; v < order.size(); v++) {
+			int i = order[v];
+			float age = 1.0f - lifespan[i] / maxLifeSpan;
+			instance[v].centerRadius = glm::vec4(position[i], radius);
+			instance[v].color = glm::vec4(gradients.at(flameRow[i], age), 1.0f);
+		}
+		queue.flush(stats); //one multi draw for the particles
+		if (heatmap.enabled) heatmap.end(stats);
+		else if (oit.enabled) oit.end(stats);
+		else if (lowRes.enabled) lowRes.end(stats);
+
+		if (bench.enabled) glFinish(); //count the GPU work in the render phase
+		perf.end(PHASE_RENDER);
+		perf.endFrame();
+		bench.endRender();
+		if (bench.done()) {
+			bench.report();
+			quit = true;
+		}
 
-		
 		if (saveOutput) Win2PPM(screen_width, screen_height);
 
+		stats.endFrame(position.size());
+		StatsOverlayDraw(overlay, stats, screen_width, screen_height);
+		allocTracker.endFrame();
+		glTraceEndFrame();
+
 		SDL_GL_SwapWindow(window); //Double buffering
 	}
 
 	//Clean Up
-	glDeleteProgram(shaderProgram);
-	glDeleteShader(fragmentShader);
-	glDeleteShader(vertexShader);
+	shaders.deleteAll();
+	queue.deleteBuffer();
 
-	glDeleteBuffers(1, &vbo);
+	arena.deleteBuffers();
+	heatmap.deleteBuffers();
+	lowRes.deleteBuffers();
+	oit.deleteBuffers();
+	gradients.deleteTexture();
 
-	glDeleteVertexArrays(1, &vao);
+	StatsOverlayDelete(overlay);
+	stats.close();
+	allocTracker.report();
+	perf.report();
+	glTraceReport();
 
 	SDL_GL_DeleteContext(context);
 	SDL_Quit();
@@ -556,7 +462,8 @@ bool IsUnderCone(glm::vec3 point, float radius, float height) {
 	}
 }
 
-void computePhysics(int i, float dt) {
+//Returns true when the particle left the scene and was removed
+bool computePhysics(int i, float dt) {
 	//glm::vec3 acceleration = glm::vec3(0.0f,0.0f,-10.0f);//-9.8;
 	//velocity[i] = velocity[i] + acceleration * dt;
 	position[i] = position[i] + velocity[i] * dt;
@@ -566,106 +473,14 @@ void computePhysics(int i, float dt) {
 		velocity[i].z *= -.95;*/
 		position.erase(position.begin() + i);
 		velocity.erase(velocity.begin() + i);
-		color.erase(color.begin() + i);
+		flameRow.erase(flameRow.begin() + i);
 		lifespan.erase(lifespan.begin() + i);
+		depthSort.remove(i);
+		return true;
 	}
+	return false;
 }
 
-//// Create a GLSL program object from vertex and fragment shader files
-//GLuint InitShader(const char* vShaderFileName, const char* fShaderFileName) {
-//	GLuint vertex_shader, fragment_shader;
-//	GLchar *vs_text, *fs_text;
-//	GLuint program;
-//
-//	// check GLSL version
-//	printf("GLSL version: %s\n\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
-//
-//	// Create shader handlers
-//	vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-//	fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-//
-//	// Read source code from shader files
-//	vs_text = readShaderSource(vShaderFileName);
-//	fs_text = readShaderSource(fShaderFileName);
-//
-//	// error check
-//	if (vs_text == NULL) {
-//		printf("Failed to read from vertex shader file %s\n", vShaderFileName);
-//		exit(1);
-//	}
-//	else if (DEBUG_ON) {
-//		printf("Vertex Shader:\n=====================\n");
-//		printf("%s\n", vs_text);
-//		printf("=====================\n\n");
-//	}
-//	if (fs_text == NULL) {
-//		printf("Failed to read from fragent shader file %s\n", fShaderFileName);
-//		exit(1);
-//	}
-//	else if (DEBUG_ON) {
-//		printf("\nFragment Shader:\n=====================\n");
-//		printf("%s\n", fs_text);
-//		printf("=====================\n\n");
-//	}
-//
-//	// Load Vertex Shader
-//	const char *vv = vs_text;
-//	glShaderSource(vertex_shader, 1, &vv, NULL);  //Read source
-//	glCompileShader(vertex_shader); // Compile shaders
-//
-//									// Check for errors
-//	GLint  compiled;
-//	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &compiled);
-//	if (!compiled) {
-//		printf("Vertex shader failed to compile:\n");
-//		if (DEBUG_ON) {
-//			GLint logMaxSize, logLength;
-//			glGetShaderiv(vertex_shader, GL_INFO_LOG_LENGTH, &logMaxSize);
-//			printf("printing error message of %d bytes\n", logMaxSize);
-//			char* logMsg = new char[logMaxSize];
-//			glGetShaderInfoLog(vertex_shader, logMaxSize, &logLength, logMsg);
-//			printf("%d bytes retrieved\n", logLength);
-//			printf("error message: %s\n", logMsg);
-//			delete[] logMsg;
-//		}
-//		exit(1);
-//	}
-//
-//	// Load Fragment Shader
-//	const char *ff = fs_text;
-//	glShaderSource(fragment_shader, 1, &ff, NULL);
-//	glCompileShader(fragment_shader);
-//	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &compiled);
-//
-//	//Check for Errors
-//	if (!compiled) {
-//		printf("Fragment shader failed to compile\n");
-//		if (DEBUG_ON) {
-//			GLint logMaxSize, logLength;
-//			glGetShaderiv(fragment_shader, GL_INFO_LOG_LENGTH, &logMaxSize);
-//			printf("printing error message of %d bytes\n", logMaxSize);
-//			char* logMsg = new char[logMaxSize];
-//			glGetShaderInfoLog(fragment_shader, logMaxSize, &logLength, logMsg);
-//			printf("%d bytes retrieved\n", logLength);
-//			printf("error message: %s\n", logMsg);
-//			delete[] logMsg;
-//		}
-//		exit(1);
-//	}
-//
-//	// Create the program
-//	program = glCreateProgram();
-//
-//	// Attach shaders to program
-//	glAttachShader(program, vertex_shader);
-//	glAttachShader(program, fragment_shader);
-//
-//	// Link and set program to use
-//	glLinkProgram(program);
-//
-//	return program;
-//}
-
 void Win2PPM(int width, int height) {
 	char outdir[10] = "out/"; //Must be defined!
 	int i, j;
@@ -675,7 +490,7 @@ void Win2PPM(int width, int height) {
 	unsigned char *image;
 
 	/* Allocate our buffer for the image */
-	image = (unsigned char *)malloc(3 * width*height * sizeof(char));
+	image = new (nothrow) unsigned char[3 * width*height];
 	if (image == NULL) {
 		fprintf(stderr, "ERROR: Failed to allocate memory for image\n");
 	}
@@ -700,7 +515,7 @@ void Win2PPM(int width, int height) {
 		}
 	}
 
-	free(image);
+	delete[] image;
 	fclose(fptr);
 	counter++;
 }
\ No newline at end of file
@@ -19,6 +19,7 @@
 //  g++ Bounce.cpp glad/glad.c -lGL -lSDL; ./a.out
 
 #include "glad.h"  //Include order can matter here
+#include "GL_Trace.h"  //build with -DGL_TRACE to count GL calls per frame
 #ifndef _WIN32
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengl.h>
@@ -38,6 +39,19 @@
 #include "glm.hpp"
 #include "gtc/matrix_transform.hpp"
 #include "gtc/type_ptr.hpp"
+#include "Benchmark.h"
+#include "Stats_Overlay.h"
+#include "Perf_Counters.h"
+#include "Alloc_Tracker.h" //build with -DTRACK_ALLOCS to count heap allocations per frame
+#include "Shader_Manager.h"
+#include "Render_Queue.h"
+#include "Frustum_Cull.h"
+#include "Depth_Sort.h"
+#include "Weighted_OIT.h"
+#include "Overdraw_Heatmap.h"
+#include "Color_Gradient.h"
+#include "Emitter_Shapes.h"
+#include "Stateless_Burst.h"
 
 #include <fstream>
 using namespace std;
@@ -47,64 +61,39 @@ int screen_width = 800;
 int screen_height = 600;
 
 //changed 02/03/2018
-vector<glm::vec3>position;
-vector<glm::vec3>velocity;
-vector<glm::vec3>color;
-vector<float>lifespan;
+ParticleVector<glm::vec3>position;
+ParticleVector<glm::vec3>velocity;
+ParticleVector<float>lifespan; //the color and alpha follow from it, see the gradients below
 float radius = 0.02;
 float floorPos = -1.2f;
 
-// Shader sources
-const GLchar* vertexSource =
-"#version 150 core\n"
-"in vec3 position;"
-//"in vec3 inColor;"
-//the color will be changed in the OpenGL part
-//change the number of particles
-"uniform vec3 inColor;"
-"in vec3 inNormal;"
-"const vec3 inLightDir = normalize(vec3(0,2,2));"
-"out vec3 Color;"
-"out vec3 normal;"
-"out vec3 lightDir;"
-"uniform mat4 model;"
-"uniform mat4 view;"
-"uniform mat4 proj;"
-"void main() {"
-"   Color = inColor;"
-"   gl_Position = proj * view * model * vec4(position, 1.0);"
-"   vec4 norm4 = transpose(inverse(model)) * vec4(inNormal, 1.0);"
-"   normal = normalize(norm4.xyz);"
-"   lightDir = (view * vec4(inLightDir, 0)).xyz;"
-"}";
-
-const GLchar* fragmentSource =
-"#version 150 core\n"
-"in vec3 Color;"
-"in vec3 normal;"
-"in vec3 lightDir;"
-"out vec4 outColor;"
-"const float ambient = .2;"
-"uniform float alpha;"
-"void main() {"
-"   vec3 diffuseC = Color * max(dot(lightDir, normal), 0);"
-"   vec3 ambC = Color * ambient;"
-// the alpha channel of all pixels are 1.0, i.e. the opacity is 100%
-"   outColor = vec4(diffuseC+ambC, alpha);"
-"}";
-
 bool fullscreen = false;
 void Win2PPM(int width, int height);
 void computePhysics(int i, float dt);
 float randf();
 
-//Index of where to model, view, and projection matricies are stored on the GPU
-GLint uniModel, uniView, uniProj, uniColor, uniAlpha;
-
 float aspect; //aspect ratio (needs to be updated if the window is resized)
 
+Benchmark bench; //enabled with --benchmark, see Benchmark.h
+ParticleStats stats; //per frame counters, see Particle_Stats.h
+StatsOverlay overlay;
+PerfCounters perf; //--perf, hardware counters per frame phase
+RenderQueue queue; //draws sorted by state, see Render_Queue.h
+Frustum frustum; //particles outside the view are not drawn
+DepthSort depthSort; //back to front order for blending
+WeightedOIT oit; //--oit, blending without the sort, see Weighted_OIT.h
+OverdrawHeatmap heatmap; //--overdraw, fragments per pixel of the particle pass
+ColorGradients gradients; //color and alpha over the particles' age
+StatelessBursts bursts; //--stateless, the burst drawn from one descriptor, see Stateless_Burst.h
+
 int main(int argc, char *argv[]) {
 	SDL_Init(SDL_INIT_VIDEO);  //Initialize Graphics (for OpenGL)
+	StatsParseArgs(stats, argc, argv);
+	OverdrawParseArgs(heatmap, argc, argv);
+	OITParseArgs(oit, argc, argv);
+	StatelessParseArgs(bursts, argc, argv);
+	PerfParseArgs(perf, argc, argv);
+	BenchmarkParseArgs(bench, "fireworks", argc, argv);
 
 	//Ask SDL to get a recent version of OpenGL (3.2 or greater)
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -112,7 +101,7 @@ int main(int argc, char *argv[]) {
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 4);
 
 	//Create a window (offsetx, offsety, width, height, flags)
-	SDL_Window* window = SDL_CreateWindow("My OpenGL Program", 150, 50, screen_width, screen_height, SDL_WINDOW_OPENGL);
+	SDL_Window* window = SDL_CreateWindow("My OpenGL Program", 150, 50, screen_width, screen_height, SDL_WINDOW_OPENGL | (bench.enabled ? SDL_WINDOW_HIDDEN : 0));
 	aspect = screen_width / (float)screen_height; //aspect ratio (needs to be updated if the window is resized)
 
 	//The above window cannot be resized which makes some code slightly easier.
@@ -134,100 +123,42 @@ int main(int argc, char *argv[]) {
 		printf("ERROR: Failed to initialize OpenGL context.\n");
 		return -1;
 	}
-
-	//Build a Vertex Array Object. This stores the VBO and attribute mappings in one object
-	GLuint vao;
-	glGenVertexArrays(1, &vao); //Create a VAO
-	glBindVertexArray(vao); //Bind the above created VAO to the current context
-
-	ifstream modelFile;
-	modelFile.open("sphere.txt");
-	int numLines = 0;
-	modelFile >> numLines;
-	float *vertices = new float[numLines];
-	for (int i = 0; i < numLines; i++) {
-		modelFile >> vertices[i];
-	}
-	printf("wall numLines: %d\n", numLines);
-	int numVerts = numLines / 8;
-	modelFile.close();
-
-	//Allocate memory on the graphics card to store geometry (vertex buffer object)
-	GLuint vbo;
-	glGenBuffers(1, &vbo);  //Create 1 buffer called vbo
-	glBindBuffer(GL_ARRAY_BUFFER, vbo); //Set the vbo as the active array buffer (Only one buffer can be active at a time)
-	glBufferData(GL_ARRAY_BUFFER, numLines * sizeof(float), vertices, GL_STATIC_DRAW); //upload vertices to vbo
-	//GL_STATIC_DRAW means we won't change the geometry, GL_DYNAMIC_DRAW = geometry changes infrequently
-	//GL_STREAM_DRAW = geom. changes frequently.  This effects which types of GPU memory is used
-
-	//Load the vertex Shader
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexSource, NULL);
-	glCompileShader(vertexShader);
-
-	//Let's double check the shader compiled 
-	GLint status;
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-	if (!status) {
-		char buffer[512];
-		glGetShaderInfoLog(vertexShader, 512, NULL, buffer);
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
-			"Compilation Error",
-			"Failed to Compile: Check Consol Output.",
-			NULL);
-		printf("Vertex Shader Compile Failed. Info:\n\n%s\n", buffer);
-	}
-
-	//Load the fragment Shader
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-	glCompileShader(fragmentShader);
-
-	//Double check the shader compiled 
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-	if (!status) {
-		char buffer[512];
-		glGetShaderInfoLog(fragmentShader, 512, NULL, buffer);
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
-			"Compilation Error",
-			"Failed to Compile: Check Consol Output.",
-			NULL);
-		printf("Fragment Shader Compile Failed. Info:\n\n%s\n", buffer);
-	}
-
-	//Join the vertex and fragment shaders together into one program
-	GLuint shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	glBindFragDataLocation(shaderProgram, 0, "outColor"); // set output
-	glLinkProgram(shaderProgram); //run the linker
-
-	glUseProgram(shaderProgram); //Set the active shader (only one can be used at a time)
-
-	//Tell OpenGL how to set fragment shader input 
-	GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-	glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
-	//Attribute, vals/attrib., type, normalized?, stride, offset
-	//Binds to VBO current GL_ARRAY_BUFFER 
-	glEnableVertexAttribArray(posAttrib);
-
-	/*GLint colAttrib = glGetAttribLocation(shaderProgram, "inColor");
-	glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(colAttrib);*/
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	GLint normAttrib = glGetAttribLocation(shaderProgram, "inNormal");
-	glVertexAttribPointer(normAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
-	glEnableVertexAttribArray(normAttrib);
-
-	glBindVertexArray(0); //Unbind the VAO
-
-	//Where to model, view, and projection matricies are stored on the GPU
-	uniModel = glGetUniformLocation(shaderProgram, "model");
-	uniView = glGetUniformLocation(shaderProgram, "view");
-	uniProj = glGetUniformLocation(shaderProgram, "proj");
-	uniColor = glGetUniformLocation(shaderProgram, "inColor");
-	uniAlpha = glGetUniformLocation(shaderProgram, "alpha");
+	if (bench.enabled) SDL_GL_SetSwapInterval(0); //don't wait for vsync while benchmarking
+	StatsOverlayInit(overlay);
+
+	//All meshes share one vertex buffer and VAO so the whole frame is one multi draw (see Mesh_Arena.h)
+	MeshArena arena;
+	int sphereMesh = arena.addMesh("sphere.txt");
+	if (sphereMesh < 0) return -1;
+	arena.upload();
+	MeshRange sphere = arena.mesh(sphereMesh);
+
+	//Load the shaders from vertex.glsl and fragment.glsl (or the binary cache, see Shader_Manager.h)
+	ShaderManager shaders;
+	GLuint shaderProgram = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED\n#define GRADIENT"); //meshes are only moved and scaled
+	GLuint oitProgram = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED\n#define GRADIENT\n#define OIT");
+	oit.load(shaders);
+	bursts.load(shaders);
+	heatmap.load(shaders);
+	shaders.finish();
+	heatmap.init(screen_width, screen_height);
+	oit.init(screen_width, screen_height);
+
+	//The queue looks up the uniforms and points every program at the shared camera buffer
+	queue.init(&arena);
+	queue.addProgram(shaderProgram);
+	queue.addProgram(oitProgram);
+	queue.addProgram(heatmap.countProgram);
+	queue.addProgram(bursts.program); //only for the camera block, the sparks are drawn by bursts.draw()
+	queue.addProgram(bursts.oitProgram);
+	queue.addProgram(bursts.countProgram);
+
+	//the tail fades out along its length, the burst goes from white to red while it fades
+	GradientKey tailKeys[] = { {0.0f, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)}, {1.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.0f)} };
+	GradientKey burstKeys[] = { {0.0f, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)}, {1.0f, glm::vec4(1.0f, 0.0f, 0.0f, 0.0f)} };
+	int tailGradient = gradients.add(tailKeys, 2);
+	int burstGradient = gradients.add(burstKeys, 2);
+	gradients.upload();
 
 	glEnable(GL_DEPTH_TEST);
 
@@ -239,7 +170,8 @@ int main(int argc, char *argv[]) {
 	SDL_Event windowEvent;
 	bool quit = false;
 
-	srand(time(NULL));
+	srand(bench.enabled ? bench.seed : time(NULL));
+	EmitRng rng(rand()); //for the emitter shapes, seeded here so benchmark runs repeat
 
 	//particle system start here
 	//generate the emitter shape
@@ -247,6 +179,7 @@ int main(int argc, char *argv[]) {
 	
 	float lastTime = SDL_GetTicks() / 1000.f;
 	float dt = 0;
+	float simTime = 0;
 
 	glm::vec3 ini_position = glm::vec3(0.0f, 0.0f, 0.8f);
 	float maxLifeSpan = 2;
@@ -258,22 +191,21 @@ int main(int argc, char *argv[]) {
 	for (int i = 0; i < numTails; i++) {
 		position.push_back(glm::vec3(0.0f, 0.0f, -(float)(i/numTails)*0.2-2.0f));
 		velocity.push_back(glm::vec3(0.0f, 0.0f, 1.0f));
-		color.push_back(glm::vec3(1.0f, 1.0f, 1.0f));
 		lifespan.push_back(maxLifeSpan);
 	}
 
-	//generate new particles
+	//generate new particles, all at the burst point, flying out evenly in every direction
 	float vel = 1.0f;
-	for (int i = numTails; i < numParticles; i++) {
-		//choose random particle location
-		position.push_back(ini_position);
-		//choose random particle velocity
-		float theta = randf()*2*PI;
-		float phi = randf()*PI;
-		velocity.push_back(glm::vec3(vel*sin(phi)*cos(theta), vel*sin(phi)*sin(theta), vel*cos(phi)));
-		color.push_back(glm::vec3(1.0f, 1.0f, 0.0f));
-		lifespan.push_back(maxLifeSpan);
+	int burstSize = numParticles - numTails;
+	//stateless, the sparks exist only as this descriptor, it starts when the tail arrives
+	BurstDescriptor burst = { ini_position, -1.0f, bursts.sparks > 0 ? bursts.sparks : burstSize, (uint32_t)rand(), vel, maxLifeSpan, burstGradient };
+	bool burstOver = false;
+	if (!bursts.enabled) {
+		Emit(PointShape(ini_position), burstSize, position, rng);
+		Emit(SphereSurfaceShape(glm::vec3(0.0f), vel), burstSize, velocity, rng);
+		lifespan.resize(lifespan.size() + burstSize, maxLifeSpan);
 	}
+	stats.born(position.size() + (bursts.enabled ? burst.count : 0)); //the whole firework is spawned up front
 
 	while (!quit) {
 		while (SDL_PollEvent(&windowEvent)) {
@@ -284,6 +216,12 @@ int main(int argc, char *argv[]) {
 				quit = true; ; //Exit event loop
 			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_f) //If "f" is pressed
 				fullscreen = !fullscreen;
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_i) //"i" shows the stats overlay
+				overlay.visible = !overlay.visible;
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_h) //"h" shows the overdraw heatmap
+				heatmap.enabled = heatmap.supported && !heatmap.enabled;
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_o) //"o" switches between sorting and weighted OIT
+				oit.enabled = oit.supported && !oit.enabled;
 			SDL_SetWindowFullscreen(window, fullscreen ? SDL_WINDOW_FULLSCREEN : 0); //Set to full screen 
 		}
 
@@ -295,85 +233,122 @@ int main(int argc, char *argv[]) {
 		if (dt > .1) dt = .1; //Have some max dt
 		lastTime = SDL_GetTicks() / 1000.f;
 		if (saveOutput) dt += .07; //Fix framerate at 14 FPS
+		if (bench.enabled) dt = bench.dt; //fixed step so benchmark runs are comparable
+		simTime += dt;
 
 		glm::mat4 view = glm::lookAt(
 			glm::vec3(3.f, 0.f, 0.f),  //Cam Position
 			glm::vec3(0.0f, 0.0f, 0.0f),  //Look at point
 			glm::vec3(0.0f, 0.0f, 1.0f)); //Up
-		GLint uniView = glGetUniformLocation(shaderProgram, "view");
-		glUniformMatrix4fv(uniView, 1, GL_FALSE, glm::value_ptr(view));
 
 		glm::mat4 proj = glm::perspective(3.14f / 4, aspect, 1.0f, 10.0f); //FOV, aspect, near, far
-		GLint uniProj = glGetUniformLocation(shaderProgram, "proj");
-		glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(proj));
+		queue.setCamera(view, proj);
+		frustum.update(proj * view);
+		stats.uploaded(2 * sizeof(glm::mat4));
 
-		//generate new particles
-		if (position[0].z < 0.8f) {
-			for (int i = 0; i < numTails; i++) {
-				//choose random particle velocity
-				glUniform1f(uniAlpha, (float)(1.0f-i/numTails));
-				glm::vec3 inColor = color[i];
-				glUniform3f(uniColor, inColor.r, inColor.g, inColor.b);
-				glm::mat4 model(1.0f);
-				model = glm::translate(model, position[i]);
-				model = glm::scale(model, glm::vec3(radius));
-				glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
-				glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
+		bench.beginFrame();
+		perf.begin(PHASE_SIMULATE);
 
+		//the tail rises first, then the burst particles fly out and fade
+		bool rising = position[0].z < 0.8f;
+		if (rising) {
+			for (int i = 0; i < numTails; i++) {
 				position[i] = position[i] + velocity[i] * dt;
-
-				//computePhysics(i, dt);
-				//printf("%d\n", i);
-				glBindVertexArray(vao);
-				glDrawArrays(GL_TRIANGLES, 0, numVerts); //(Primitives, Which VBO, Number of vertices)
 			}
-			//system("pause");
 		}
 		else {
+			if (burst.startTime < 0) burst.startTime = simTime;
 			for (int i = numTails; i < position.size(); i++) {
 				lifespan[i] -= dt;
-				float ratio = lifespan[i] / maxLifeSpan;
-				//printf("ratio:%f", ratio);
-				glUniform1f(uniAlpha, ratio);
-
-				glm::vec3 inColor = glm::vec3(color[i].r, color[i].g*ratio, color[i].b + ratio);
-				glUniform3f(uniColor, inColor.r, inColor.g, inColor.b);
-
-				glm::mat4 model(1.0f);
-				if (lifespan[i] <= 0) {// draw the "alive" particles
+				if (lifespan[i] <= 0) {
 					position.erase(position.begin() + i);
 					velocity.erase(velocity.begin() + i);
-					color.erase(color.begin() + i);
 					lifespan.erase(lifespan.begin() + i);
+					stats.died();
+					depthSort.remove(i);
+					i--;
 					continue;
 				}
-				model = glm::translate(model, position[i]);
-				model = glm::scale(model, glm::vec3(radius));
-				glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
-
 				position[i] = position[i] + velocity[i] * dt;
-
-				glBindVertexArray(vao);
-				glDrawArrays(GL_TRIANGLES, 0, numVerts); //(Primitives, Which VBO, Number of vertices)
 			}
 		}
-		
+		int sparks = bursts.enabled && StatelessBursts::alive(burst, simTime) ? burst.count : 0;
+		if (bursts.enabled && !rising && !sparks && !burstOver) {
+			stats.died(burst.count);
+			burstOver = true;
+		}
+		bench.endSimulate(rising ? numTails : position.size() - numTails + sparks);
+		perf.end(PHASE_SIMULATE);
+		perf.begin(PHASE_RENDER);
+
+		stats.culled(frustum.cull(position, radius));
+		bool sorted = heatmap.enabled || !oit.enabled; //weighted OIT needs no order
+		if (sorted) depthSort.sort(position, frustum.visible, view); //far to near, the queue keeps this order
+		const std::vector<int>& order = sorted ? depthSort.order : frustum.visible;
+		GLuint particleProgram = shaderProgram;
+		if (heatmap.enabled) {
+			heatmap.begin(); //counts the sorted pass
+			particleProgram = heatmap.countProgram;
+		}
+		else if (oit.enabled) {
+			oit.begin(false); //nothing opaque to test against
+			particleProgram = oitProgram;
+		}
+		//the tails while rising, the burst particles after, written in order straight into the instances
+		size_t drawn = 0;
+		for (size_t v = 0; v < order.size(); v++) drawn += (order[v] < numTails) == rising;
+		ArenaInstance* instance = queue.submitInstances(particleProgram, sphere, drawn, gradients.tex);
+		for (size_t v = 0, w = 0; v < order.size(); v++) {
+			int i = order[v];
+			if ((i < numTails) != rising) continue;
+			float age = rising ? i / numTails : 1.0f - lifespan[i] / maxLifeSpan;
+			instance[w].centerRadius = glm::vec4(position[i], radius);
+			instance[w++].color = glm::vec4(gradients.at(rising ? tailGradient : burstGradient, age), 1.0f);
+		}
+		queue.flush(stats); //same state for every sphere, so they stay in the order above
+		//the stateless sparks are one instanced draw, unsorted, so they don't write depth over each other
+		if (sparks && frustum.sphereVisible(burst.origin, burst.speed * (simTime - burst.startTime) + radius)) {
+			GLuint sparkProgram = heatmap.enabled ? bursts.countProgram : (oit.enabled ? bursts.oitProgram : bursts.program);
+			glDepthMask(GL_FALSE);
+			stats.uploaded(bursts.draw(burst, simTime, sphere, radius, gradients, sparkProgram, stats));
+			glDepthMask(GL_TRUE);
+		}
+		if (heatmap.enabled) heatmap.end(stats);
+		else if (oit.enabled) oit.end(stats);
+
+		if (bench.enabled) glFinish(); //count the GPU work in the render phase
+		perf.end(PHASE_RENDER);
+		perf.endFrame();
+		bench.endRender();
+		if (bench.done()) {
+			bench.report();
+			quit = true;
+		}
 
-		
-		
 		if (saveOutput) Win2PPM(screen_width, screen_height);
 
+		stats.endFrame(position.size() + sparks);
+		StatsOverlayDraw(overlay, stats, screen_width, screen_height);
+		allocTracker.endFrame();
+		glTraceEndFrame();
+
 		SDL_GL_SwapWindow(window); //Double buffering
 	}
 
 	//Clean Up
-	glDeleteProgram(shaderProgram);
-	glDeleteShader(fragmentShader);
-	glDeleteShader(vertexShader);
+	shaders.deleteAll();
+	queue.deleteBuffer();
 
-	glDeleteBuffers(1, &vbo);
+	arena.deleteBuffers();
+	heatmap.deleteBuffers();
+	oit.deleteBuffers();
+	gradients.deleteTexture();
 
-	glDeleteVertexArrays(1, &vao);
+	StatsOverlayDelete(overlay);
+	stats.close();
+	allocTracker.report();
+	perf.report();
+	glTraceReport();
 
 	SDL_GL_DeleteContext(context);
 	SDL_Quit();
@@ -404,7 +379,7 @@ void Win2PPM(int width, int height) {
 	unsigned char *image;
 
 	/* Allocate our buffer for the image */
-	image = (unsigned char *)malloc(3 * width*height * sizeof(char));
+	image = new (nothrow) unsigned char[3 * width*height];
 	if (image == NULL) {
 		fprintf(stderr, "ERROR: Failed to allocate memory for image\n");
 	}
@@ -429,7 +404,7 @@ void Win2PPM(int width, int height) {
 		}
 	}
 
-	free(image);
+	delete[] image;
 	fclose(fptr);
 	counter++;
 }
\ No newline at end of file
@@ -0,0 +1,240 @@
+//Particle physics put together from stages at compile time
+//Include after glm. A scene lists its forces and constraints as the template arguments of ForcePipeline
+//and step() runs them all in one loop over the particle arrays: the forces add up to an acceleration, the
+//integrator moves the particle with it, then the constraints fix up position and velocity, in the listed
+//order. Every stage's code is inlined into that loop, there are no virtual calls and nothing checks at
+//run time which stages the scene has.
+//  ForcePipeline<Gravity, FloorPlane, SphereObstacle> physics;
+//  physics.stage<FloorPlane>().height = floorPos + radius;          //parameters, once
+//  IntegratorParseArgs(physics, argc, argv);                        //--integrator euler|verlet|rk4
+//  stats.died(physics.step(dt, position, velocity, lifespan));      //every frame
+//Stages that kill (KillBox) make step() remove those particles from position, velocity and any further
+//arrays passed to it, keeping the order. A new stage is a struct with force(), constrain() and kill()
+//(ForceStage has empty ones to inherit) and KILLS set to 1 if kill() can return true.
+//The integrator is picked once per step() and each one gets its own copy of the loop. Semi implicit Euler
+//(the default, what the demos always did) is first order, velocity Verlet second and RK4 fourth order in
+//dt, for 1, 2 and 4 force evaluations per particle. Integrator_Accuracy.cpp measures what that buys.
+//Constraints see where the particle started the step as well, so they can test the swept path instead of
+//only the end point and fast particles don't tunnel through obstacles. With maxTravel set, a particle that
+//would move further than that in one step takes as many substeps as it needs (up to maxSubsteps), the
+//slow ones still take one.
+
+#ifndef FORCE_PIPELINE_H
+#define FORCE_PIPELINE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+struct ForceStage {
+	enum { KILLS = 0 };
+	void force(glm::vec3& /*a*/, const glm::vec3& /*p*/, const glm::vec3& /*v*/) const {}
+	void constrain(const glm::vec3& /*from*/, glm::vec3& /*p*/, glm::vec3& /*v*/) const {}
+	bool kill(const glm::vec3& /*p*/) const { return false; }
+};
+
+struct Gravity : ForceStage {
+	glm::vec3 g = glm::vec3(0.0f, 0.0f, -10.0f);
+	void force(glm::vec3& a, const glm::vec3&, const glm::vec3&) const { a += g; }
+};
+
+//Linear air drag, the velocity decays by k per second
+struct Drag : ForceStage {
+	float k = 0.5f;
+	void force(glm::vec3& a, const glm::vec3&, const glm::vec3& v) const { a -= k * v; }
+};
+
+//Drag towards the wind's velocity instead of towards rest
+struct Wind : ForceStage {
+	glm::vec3 velocity = glm::vec3(1.0f, 0.0f, 0.0f);
+	float k = 0.5f;
+	void force(glm::vec3& a, const glm::vec3&, const glm::vec3& v) const { a += k * (velocity - v); }
+};
+
+//Particles stay at or above height (the floor plus their radius), bouncing back with restitution. Everything
+//below is solid, so the end point alone catches any path through it.
+struct FloorPlane : ForceStage {
+	float height = -1.2f;
+	float restitution = 0.95f;
+	void constrain(const glm::vec3&, glm::vec3& p, glm::vec3& v) const {
+		if (p.z < height) {
+			p.z = height;
+			v.z *= -restitution;
+		}
+	}
+};
+
+//A solid sphere. Particles whose path this step enters it stop where they hit it, ones that ended up
+//inside anyway (they started there) are put just outside it. Either way they lose their velocity into
+//it, bouncing back with restitution. For particles with a size the radius is the obstacle's plus theirs.
+struct SphereObstacle : ForceStage {
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.5f;
+	float restitution = 0.7f;
+	void constrain(const glm::vec3& from, glm::vec3& p, glm::vec3& v) const {
+		//first t in [0,1] with |from + t * path - center| = radius
+		glm::vec3 path = p - from, f = from - center;
+		float a = glm::dot(path, path), b = glm::dot(f, path), c = glm::dot(f, f) - radius * radius;
+		float disc = b * b - a * c;
+		glm::vec3 normal;
+		if (c > 0 && b < 0 && disc >= 0 && -b - std::sqrt(disc) <= a) { //starts outside, moving in, hits within the step
+			normal = (f + path * ((-b - std::sqrt(disc)) / a)) / radius;
+		}
+		else {
+			glm::vec3 d = p - center;
+			float dist2 = glm::dot(d, d);
+			if (!(dist2 < radius * radius && dist2 > 0)) return;
+			normal = d / std::sqrt(dist2);
+		}
+		p = center + normal * (radius * 1.01f);
+		v -= (1 + restitution) * glm::dot(v, normal) * normal;
+	}
+};
+
+//Particles leaving the box are removed
+struct KillBox : ForceStage {
+	enum { KILLS = 1 };
+	glm::vec3 lo = glm::vec3(-10.0f), hi = glm::vec3(10.0f);
+	bool kill(const glm::vec3& p) const {
+		return p.x < lo.x || p.y < lo.y || p.z < lo.z || p.x > hi.x || p.y > hi.y || p.z > hi.z;
+	}
+};
+
+//Integrators, each advances p and v by dt under the acceleration f.acceleration(p, v)
+struct SemiImplicitEuler {
+	template <class Forces>
+	static void advance(const Forces& f, glm::vec3& p, glm::vec3& v, float dt) {
+		v += f.acceleration(p, v) * dt;
+		p += v * dt;
+	}
+};
+
+//Exact for constant forces, a velocity dependent force is evaluated at the Euler predicted velocity
+struct VelocityVerlet {
+	template <class Forces>
+	static void advance(const Forces& f, glm::vec3& p, glm::vec3& v, float dt) {
+		glm::vec3 a0 = f.acceleration(p, v);
+		p += (v + 0.5f * dt * a0) * dt;
+		glm::vec3 a1 = f.acceleration(p, v + a0 * dt);
+		v += 0.5f * dt * (a0 + a1);
+	}
+};
+
+struct RungeKutta4 {
+	template <class Forces>
+	static void advance(const Forces& f, glm::vec3& p, glm::vec3& v, float dt) {
+		float h = 0.5f * dt;
+		glm::vec3 v1 = v, a1 = f.acceleration(p, v1);
+		glm::vec3 v2 = v + h * a1, a2 = f.acceleration(p + h * v1, v2);
+		glm::vec3 v3 = v + h * a2, a3 = f.acceleration(p + h * v2, v3);
+		glm::vec3 v4 = v + dt * a3, a4 = f.acceleration(p + dt * v3, v4);
+		p += (dt / 6.0f) * (v1 + 2.0f * (v2 + v3) + v4);
+		v += (dt / 6.0f) * (a1 + 2.0f * (a2 + a3) + a4);
+	}
+};
+
+enum Integrator { INTEGRATE_EULER, INTEGRATE_VERLET, INTEGRATE_RK4 };
+
+//Compile time "any stage kills"
+template <class... Stages> struct AnyStageKills { enum { value = 0 }; };
+template <class First, class... Rest> struct AnyStageKills<First, Rest...> {
+	enum { value = First::KILLS || AnyStageKills<Rest...>::value };
+};
+
+template <class... Stages>
+struct ForcePipeline : Stages... {
+	enum { KILLS = AnyStageKills<Stages...>::value };
+	Integrator integrator = INTEGRATE_EULER;
+	float maxTravel = 0; //longest move in one substep, 0 for always one step
+	int maxSubsteps = 16;
+
+	template <class Stage>
+	Stage& stage() { return static_cast<Stage&>(*this); }
+	template <class Stage>
+	const Stage& stage() const { return static_cast<const Stage&>(*this); }
+
+	//Sum of the stages' forces. The braced lists run the stages in the listed order.
+	glm::vec3 acceleration(const glm::vec3& p, const glm::vec3& v) const {
+		glm::vec3 a(0.0f);
+		int forces[] = { 0, (static_cast<const Stages&>(*this).force(a, p, v), 0)... };
+		(void)forces;
+		return a;
+	}
+
+	//One particle through every stage, false if a stage killed it
+	template <class Method>
+	bool apply(glm::vec3& p, glm::vec3& v, float dt) const {
+		int substeps = 1;
+		if (maxTravel > 0) {
+			float travel = std::sqrt(glm::dot(v, v)) * dt;
+			if (travel > maxTravel) substeps = std::min((int)std::ceil(travel / maxTravel), maxSubsteps);
+		}
+		float h = dt / substeps;
+		for (int s = 0; s < substeps; s++) {
+			glm::vec3 from = p;
+			Method::advance(*this, p, v, h);
+			int constraints[] = { 0, (static_cast<const Stages&>(*this).constrain(from, p, v), 0)... };
+			(void)constraints;
+		}
+		if (!KILLS) return true;
+		bool dead = false;
+		int kills[] = { 0, (dead = dead || static_cast<const Stages&>(*this).kill(p), 0)... };
+		(void)kills;
+		return !dead;
+	}
+
+	//Steps every particle with the chosen integrator, returns how many were killed
+	template <class Vector, class... Extra>
+	int step(float dt, Vector& position, Vector& velocity, Extra&... extra) const {
+		switch (integrator) {
+		case INTEGRATE_VERLET: return step<VelocityVerlet>(dt, position, velocity, extra...);
+		case INTEGRATE_RK4: return step<RungeKutta4>(dt, position, velocity, extra...);
+		default: return step<SemiImplicitEuler>(dt, position, velocity, extra...);
+		}
+	}
+
+	template <class Method, class Vector, class... Extra>
+	int step(float dt, Vector& position, Vector& velocity, Extra&... extra) const {
+		int n = position.size();
+		if (!KILLS) {
+			for (int i = 0; i < n; i++) apply<Method>(position[i], velocity[i], dt);
+			return 0;
+		}
+		int alive = 0;
+		for (int i = 0; i < n; i++) {
+			if (!apply<Method>(position[i], velocity[i], dt)) continue;
+			if (alive != i) {
+				position[alive] = position[i];
+				velocity[alive] = velocity[i];
+				int moved[] = { 0, (extra[alive] = extra[i], 0)... };
+				(void)moved;
+			}
+			alive++;
+		}
+		position.resize(alive);
+		velocity.resize(alive);
+		int resized[] = { 0, (extra.resize(alive), 0)... };
+		(void)resized;
+		return n - alive;
+	}
+};
+
+inline bool IntegratorFromName(const char* name, Integrator& integrator) {
+	if (strcmp(name, "euler") == 0) integrator = INTEGRATE_EULER;
+	else if (strcmp(name, "verlet") == 0) integrator = INTEGRATE_VERLET;
+	else if (strcmp(name, "rk4") == 0) integrator = INTEGRATE_RK4;
+	else return false;
+	return true;
+}
+
+template <class Pipeline>
+void IntegratorParseArgs(Pipeline& physics, int argc, char* argv[]) {
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--integrator") == 0 && !IntegratorFromName(argv[i + 1], physics.integrator)) {
+			fprintf(stderr, "Unknown integrator %s, expected euler, verlet or rk4\n", argv[i + 1]);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,93 @@
+//View frustum culling of the particle spheres
+//Include after glm. update() takes proj * view and extracts the six planes, cull() tests every particle
+//sphere against them and fills visible with the indices of the ones that can be on screen, so the demos
+//only submit (and upload instance data for) those.
+//With SSE the test runs on 4 particles at a time, the positions are gathered from the glm::vec3 array.
+
+#ifndef FRUSTUM_CULL_H
+#define FRUSTUM_CULL_H
+
+#include <cmath>
+#include <vector>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE
+#endif
+
+struct Frustum {
+	float planes[6][4]; //a,b,c,d with the normal pointing inside, a point p is inside if dot(n,p)+d >= 0
+	std::vector<int> visible;
+
+	//Planes of a combined projection * view matrix (Gribb/Hartmann)
+	void update(const glm::mat4& m) {
+		for (int i = 0; i < 3; i++) {
+			for (int c = 0; c < 4; c++) {
+				planes[2 * i][c] = m[c][3] + m[c][i];     //left, bottom, near
+				planes[2 * i + 1][c] = m[c][3] - m[c][i]; //right, top, far
+			}
+		}
+		for (int p = 0; p < 6; p++) { //normalize so d is a distance and the radius can be compared to it
+			float len = sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+			for (int c = 0; c < 4; c++) planes[p][c] /= len;
+		}
+	}
+
+	bool sphereVisible(const glm::vec3& center, float radius) const {
+		for (int p = 0; p < 6; p++) {
+			if (planes[p][0] * center.x + planes[p][1] * center.y + planes[p][2] * center.z + planes[p][3] < -radius) return false;
+		}
+		return true;
+	}
+
+	//True unless the box [lo, hi] is entirely outside one of the planes
+	bool boxVisible(const glm::vec3& lo, const glm::vec3& hi) const {
+		for (int p = 0; p < 6; p++) {
+			float x = planes[p][0] >= 0 ? hi.x : lo.x, y = planes[p][1] >= 0 ? hi.y : lo.y, z = planes[p][2] >= 0 ? hi.z : lo.z;
+			if (planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] < 0) return false;
+		}
+		return true;
+	}
+
+	//Fills visible with the particles whose sphere touches the frustum, returns how many were culled
+	template <class Vector>
+	int cull(const Vector& position, float radius) {
+		int count = position.size();
+		visible.clear();
+		if ((int)visible.capacity() < count) visible.reserve(count * 2); //rarely needed, the particle count changes slowly
+		cullRange(position, 0, count, radius);
+		return count - visible.size();
+	}
+
+	//Appends the visible particles of [first,last) to visible, for callers that already rejected whole
+	//groups of particles (e.g. the tiles of Tiled_Emitter.h) and clear visible themselves
+	template <class Vector>
+	void cullRange(const Vector& position, int first, int last, float radius) {
+		int count = last;
+		int i = first;
+#ifdef FRUSTUM_SSE
+		__m128 negRadius = _mm_set1_ps(-radius);
+		for (; i + 4 <= count; i += 4) {
+			const glm::vec3* p = &position[i];
+			__m128 x = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+			__m128 y = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+			__m128 z = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+			__m128 inside = _mm_setzero_ps();
+			for (int k = 0; k < 6; k++) {
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(planes[k][0])), _mm_mul_ps(y, _mm_set1_ps(planes[k][1]))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(planes[k][2])), _mm_set1_ps(planes[k][3])));
+				__m128 in = _mm_cmpge_ps(d, negRadius);
+				inside = k == 0 ? in : _mm_and_ps(inside, in);
+			}
+			int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; lane < 4; lane++) {
+				if (mask & (1 << lane)) visible.push_back(i + lane);
+			}
+		}
+#endif
+		for (; i < count; i++) {
+			if (sphereVisible(position[i], radius)) visible.push_back(i);
+		}
+	}
+};
+
+#endif
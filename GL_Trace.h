@@ -0,0 +1,380 @@
+//GL call interception for the particle demos
+//Build with -DGL_TRACE and include this right after glad. The GL entry points the demos use are then
+//routed through wrappers that count every call by function and flag redundant state changes:
+//binding the VAO/program/buffer/texture that is already bound, enabling what is already enabled,
+//setting a uniform to the value it already has, or looking up a uniform location that was looked up before.
+//glTraceEndFrame() prints the last frame's breakdown once per second, glTraceReport() the per frame
+//averages at exit. Without GL_TRACE both are no-ops and the GL calls are untouched.
+
+#ifndef GL_TRACE_H
+#define GL_TRACE_H
+
+#ifdef GL_TRACE
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct GLTraceCounter {
+	const char* name;
+	long long calls, redundant;           //this frame
+	long long totalCalls, totalRedundant; //whole run
+};
+
+struct GLTrace {
+	static const int maxCounters = 64;
+	GLTraceCounter counters[maxCounters];
+	int numCounters = 0;
+	long long frame = 0;
+	double lastPrint = 0, printInterval = 1.0;
+
+	//currently bound state as seen through the wrappers
+	GLuint program = 0, vao = 0;
+	GLuint drawFramebuffer = 0, readFramebuffer = 0;
+	GLint viewport[4] = { -1, -1, -1, -1 };
+	GLenum activeTexture = GL_TEXTURE0;
+	std::map<GLenum, GLuint> buffers;
+	std::map<std::pair<GLenum, GLenum>, GLuint> textures; //(unit, target)
+	std::map<GLenum, bool> caps;
+	std::map<std::pair<GLuint, GLint>, std::vector<unsigned char> > uniforms; //(program, location) -> value
+	std::set<std::pair<GLuint, std::string> > lookups;
+
+	int add(const char* name) {
+		assert(numCounters < maxCounters && "more wrapped GL functions than GLTrace::maxCounters");
+		GLTraceCounter& c = counters[numCounters];
+		c.name = name;
+		c.calls = c.redundant = c.totalCalls = c.totalRedundant = 0;
+		return numCounters++;
+	}
+
+	void call(int id, bool redundant = false) {
+		assert(id >= 0 && id < numCounters);
+		counters[id].calls++;
+		if (redundant) counters[id].redundant++;
+	}
+
+	//returns true if the uniform already had this value in the current program
+	bool uniform(GLint location, const void* data, size_t bytes) {
+		if (location < 0) return false;
+		std::vector<unsigned char>& last = uniforms[std::make_pair(program, location)];
+		if (last.size() == bytes && memcmp(last.data(), data, bytes) == 0) return true;
+		last.assign((const unsigned char*)data, (const unsigned char*)data + bytes);
+		return false;
+	}
+
+	static double now() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void print(bool totals) {
+		std::vector<GLTraceCounter*> order;
+		long long calls = 0, redundant = 0;
+		for (int i = 0; i < numCounters; i++) {
+			GLTraceCounter& c = counters[i];
+			long long n = totals ? c.totalCalls : c.calls;
+			if (n == 0) continue;
+			order.push_back(&c);
+			calls += n;
+			redundant += totals ? c.totalRedundant : c.redundant;
+		}
+		std::sort(order.begin(), order.end(), [totals](GLTraceCounter* a, GLTraceCounter* b) {
+			return (totals ? a->totalCalls : a->calls) > (totals ? b->totalCalls : b->calls);
+		});
+		double n = totals && frame > 0 ? frame : 1;
+		if (totals) printf("\nGL calls per frame over %lld frames: %.1f (%.1f redundant)\n", frame, calls / n, redundant / n);
+		else printf("GL frame %lld: %lld calls (%lld redundant)\n", frame, calls, redundant);
+		for (size_t i = 0; i < order.size(); i++) {
+			GLTraceCounter& c = *order[i];
+			printf("  %-28s %10.1f", c.name, (totals ? c.totalCalls : c.calls) / n);
+			long long r = totals ? c.totalRedundant : c.redundant;
+			if (r) printf("  (%.1f redundant)", r / n);
+			printf("\n");
+		}
+	}
+
+	void endFrame() {
+		double t = now();
+		if (lastPrint == 0) lastPrint = t;
+		if (t - lastPrint >= printInterval) {
+			print(false);
+			lastPrint = t;
+		}
+		for (int i = 0; i < numCounters; i++) {
+			counters[i].totalCalls += counters[i].calls;
+			counters[i].totalRedundant += counters[i].redundant;
+			counters[i].calls = counters[i].redundant = 0;
+		}
+		frame++;
+	}
+};
+
+GLTrace glTrace;
+
+inline void glTraceEndFrame() { glTrace.endFrame(); }
+inline void glTraceReport() { glTrace.print(true); }
+
+//Each wrapper registers its counter the first time it is called
+#define GL_TRACE_COUNTER(name) static int traceId = glTrace.add(name)
+
+inline void APIENTRY GLTrace_glUseProgram(GLuint program) {
+	GL_TRACE_COUNTER("glUseProgram");
+	glTrace.call(traceId, program == glTrace.program);
+	glTrace.program = program;
+	glad_glUseProgram(program);
+}
+inline void APIENTRY GLTrace_glBindVertexArray(GLuint array) {
+	GL_TRACE_COUNTER("glBindVertexArray");
+	glTrace.call(traceId, array == glTrace.vao);
+	glTrace.vao = array;
+	glad_glBindVertexArray(array);
+}
+inline void APIENTRY GLTrace_glBindBuffer(GLenum target, GLuint buffer) {
+	GL_TRACE_COUNTER("glBindBuffer");
+	std::map<GLenum, GLuint>::iterator it = glTrace.buffers.find(target);
+	glTrace.call(traceId, it != glTrace.buffers.end() && it->second == buffer);
+	glTrace.buffers[target] = buffer;
+	glad_glBindBuffer(target, buffer);
+}
+//Also binds the buffer to the generic target, like glBindBuffer would
+inline void APIENTRY GLTrace_glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	GL_TRACE_COUNTER("glBindBufferBase");
+	glTrace.call(traceId);
+	glTrace.buffers[target] = buffer;
+	glad_glBindBufferBase(target, index, buffer);
+}
+inline void APIENTRY GLTrace_glBindFramebuffer(GLenum target, GLuint framebuffer) {
+	GL_TRACE_COUNTER("glBindFramebuffer");
+	bool draw = target != GL_READ_FRAMEBUFFER, read = target != GL_DRAW_FRAMEBUFFER;
+	glTrace.call(traceId, (!draw || glTrace.drawFramebuffer == framebuffer) && (!read || glTrace.readFramebuffer == framebuffer));
+	if (draw) glTrace.drawFramebuffer = framebuffer;
+	if (read) glTrace.readFramebuffer = framebuffer;
+	glad_glBindFramebuffer(target, framebuffer);
+}
+inline void APIENTRY GLTrace_glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	GL_TRACE_COUNTER("glViewport");
+	GLint v[4] = { x, y, width, height };
+	glTrace.call(traceId, memcmp(v, glTrace.viewport, sizeof(v)) == 0);
+	memcpy(glTrace.viewport, v, sizeof(v));
+	glad_glViewport(x, y, width, height);
+}
+inline void APIENTRY GLTrace_glActiveTexture(GLenum texture) {
+	GL_TRACE_COUNTER("glActiveTexture");
+	glTrace.call(traceId, texture == glTrace.activeTexture);
+	glTrace.activeTexture = texture;
+	glad_glActiveTexture(texture);
+}
+inline void APIENTRY GLTrace_glBindTexture(GLenum target, GLuint texture) {
+	GL_TRACE_COUNTER("glBindTexture");
+	std::pair<GLenum, GLenum> key(glTrace.activeTexture, target);
+	std::map<std::pair<GLenum, GLenum>, GLuint>::iterator it = glTrace.textures.find(key);
+	glTrace.call(traceId, it != glTrace.textures.end() && it->second == texture);
+	glTrace.textures[key] = texture;
+	glad_glBindTexture(target, texture);
+}
+inline void APIENTRY GLTrace_glEnable(GLenum cap) {
+	GL_TRACE_COUNTER("glEnable");
+	std::map<GLenum, bool>::iterator it = glTrace.caps.find(cap);
+	glTrace.call(traceId, it != glTrace.caps.end() && it->second);
+	glTrace.caps[cap] = true;
+	glad_glEnable(cap);
+}
+inline void APIENTRY GLTrace_glDisable(GLenum cap) {
+	GL_TRACE_COUNTER("glDisable");
+	std::map<GLenum, bool>::iterator it = glTrace.caps.find(cap);
+	glTrace.call(traceId, it != glTrace.caps.end() && !it->second);
+	glTrace.caps[cap] = false;
+	glad_glDisable(cap);
+}
+inline void APIENTRY GLTrace_glBlendFunc(GLenum sfactor, GLenum dfactor) {
+	GL_TRACE_COUNTER("glBlendFunc");
+	glTrace.call(traceId);
+	glad_glBlendFunc(sfactor, dfactor);
+}
+inline void APIENTRY GLTrace_glBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha) {
+	GL_TRACE_COUNTER("glBlendFuncSeparate");
+	glTrace.call(traceId);
+	glad_glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+}
+inline void APIENTRY GLTrace_glBlendFunci(GLuint buf, GLenum src, GLenum dst) {
+	GL_TRACE_COUNTER("glBlendFunci");
+	glTrace.call(traceId);
+	glad_glBlendFunci(buf, src, dst);
+}
+inline void APIENTRY GLTrace_glDepthMask(GLboolean flag) {
+	GL_TRACE_COUNTER("glDepthMask");
+	glTrace.call(traceId);
+	glad_glDepthMask(flag);
+}
+inline void APIENTRY GLTrace_glDrawBuffers(GLsizei n, const GLenum* bufs) {
+	GL_TRACE_COUNTER("glDrawBuffers");
+	glTrace.call(traceId);
+	glad_glDrawBuffers(n, bufs);
+}
+inline GLint APIENTRY GLTrace_glGetUniformLocation(GLuint program, const GLchar* name) {
+	GL_TRACE_COUNTER("glGetUniformLocation");
+	glTrace.call(traceId, !glTrace.lookups.insert(std::make_pair(program, std::string(name))).second);
+	return glad_glGetUniformLocation(program, name);
+}
+inline void APIENTRY GLTrace_glUniform1f(GLint location, GLfloat v0) {
+	GL_TRACE_COUNTER("glUniform1f");
+	glTrace.call(traceId, glTrace.uniform(location, &v0, sizeof(v0)));
+	glad_glUniform1f(location, v0);
+}
+inline void APIENTRY GLTrace_glUniform1i(GLint location, GLint v0) {
+	GL_TRACE_COUNTER("glUniform1i");
+	glTrace.call(traceId, glTrace.uniform(location, &v0, sizeof(v0)));
+	glad_glUniform1i(location, v0);
+}
+inline void APIENTRY GLTrace_glUniform1ui(GLint location, GLuint v0) {
+	GL_TRACE_COUNTER("glUniform1ui");
+	glTrace.call(traceId, glTrace.uniform(location, &v0, sizeof(v0)));
+	glad_glUniform1ui(location, v0);
+}
+inline void APIENTRY GLTrace_glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+	GL_TRACE_COUNTER("glUniform3f");
+	GLfloat v[3] = { v0, v1, v2 };
+	glTrace.call(traceId, glTrace.uniform(location, v, sizeof(v)));
+	glad_glUniform3f(location, v0, v1, v2);
+}
+inline void APIENTRY GLTrace_glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+	GL_TRACE_COUNTER("glUniform4f");
+	GLfloat v[4] = { v0, v1, v2, v3 };
+	glTrace.call(traceId, glTrace.uniform(location, v, sizeof(v)));
+	glad_glUniform4f(location, v0, v1, v2, v3);
+}
+inline void APIENTRY GLTrace_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+	GL_TRACE_COUNTER("glUniformMatrix4fv");
+	glTrace.call(traceId, !transpose && glTrace.uniform(location, value, count * 16 * sizeof(GLfloat)));
+	glad_glUniformMatrix4fv(location, count, transpose, value);
+}
+inline void APIENTRY GLTrace_glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+	GL_TRACE_COUNTER("glBufferData");
+	glTrace.call(traceId);
+	glad_glBufferData(target, size, data, usage);
+}
+inline void APIENTRY GLTrace_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+	GL_TRACE_COUNTER("glBufferSubData");
+	glTrace.call(traceId);
+	glad_glBufferSubData(target, offset, size, data);
+}
+inline void APIENTRY GLTrace_glClear(GLbitfield mask) {
+	GL_TRACE_COUNTER("glClear");
+	glTrace.call(traceId);
+	glad_glClear(mask);
+}
+inline void APIENTRY GLTrace_glClearBufferfv(GLenum buffer, GLint drawbuffer, const GLfloat* value) {
+	GL_TRACE_COUNTER("glClearBufferfv");
+	glTrace.call(traceId);
+	glad_glClearBufferfv(buffer, drawbuffer, value);
+}
+inline void APIENTRY GLTrace_glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height) {
+	GL_TRACE_COUNTER("glCopyTexSubImage2D");
+	glTrace.call(traceId);
+	glad_glCopyTexSubImage2D(target, level, xoffset, yoffset, x, y, width, height);
+}
+inline void APIENTRY GLTrace_glClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+	GL_TRACE_COUNTER("glClearColor");
+	glTrace.call(traceId);
+	glad_glClearColor(r, g, b, a);
+}
+inline void APIENTRY GLTrace_glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+	GL_TRACE_COUNTER("glDrawArrays");
+	glTrace.call(traceId);
+	glad_glDrawArrays(mode, first, count);
+}
+inline void APIENTRY GLTrace_glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+	GL_TRACE_COUNTER("glDrawArraysInstanced");
+	glTrace.call(traceId);
+	glad_glDrawArraysInstanced(mode, first, count, instancecount);
+}
+inline void APIENTRY GLTrace_glDrawArraysInstancedBaseInstance(GLenum mode, GLint first, GLsizei count, GLsizei instancecount, GLuint baseinstance) {
+	GL_TRACE_COUNTER("glDrawArraysInstancedBaseInstance");
+	glTrace.call(traceId);
+	glad_glDrawArraysInstancedBaseInstance(mode, first, count, instancecount, baseinstance);
+}
+inline void APIENTRY GLTrace_glMultiDrawArraysIndirect(GLenum mode, const void* indirect, GLsizei drawcount, GLsizei stride) {
+	GL_TRACE_COUNTER("glMultiDrawArraysIndirect");
+	glTrace.call(traceId);
+	glad_glMultiDrawArraysIndirect(mode, indirect, drawcount, stride);
+}
+
+#undef glUseProgram
+#define glUseProgram GLTrace_glUseProgram
+#undef glBindVertexArray
+#define glBindVertexArray GLTrace_glBindVertexArray
+#undef glBindBuffer
+#define glBindBuffer GLTrace_glBindBuffer
+#undef glBindBufferBase
+#define glBindBufferBase GLTrace_glBindBufferBase
+#undef glBindFramebuffer
+#define glBindFramebuffer GLTrace_glBindFramebuffer
+#undef glViewport
+#define glViewport GLTrace_glViewport
+#undef glActiveTexture
+#define glActiveTexture GLTrace_glActiveTexture
+#undef glBindTexture
+#define glBindTexture GLTrace_glBindTexture
+#undef glEnable
+#define glEnable GLTrace_glEnable
+#undef glDisable
+#define glDisable GLTrace_glDisable
+#undef glDepthMask
+#define glDepthMask GLTrace_glDepthMask
+#undef glBlendFunc
+#define glBlendFunc GLTrace_glBlendFunc
+#undef glBlendFuncSeparate
+#define glBlendFuncSeparate GLTrace_glBlendFuncSeparate
+#undef glBlendFunci
+#define glBlendFunci GLTrace_glBlendFunci
+#undef glDrawBuffers
+#define glDrawBuffers GLTrace_glDrawBuffers
+#undef glGetUniformLocation
+#define glGetUniformLocation GLTrace_glGetUniformLocation
+#undef glUniform1f
+#define glUniform1f GLTrace_glUniform1f
+#undef glUniform1i
+#define glUniform1i GLTrace_glUniform1i
+#undef glUniform1ui
+#define glUniform1ui GLTrace_glUniform1ui
+#undef glUniform3f
+#define glUniform3f GLTrace_glUniform3f
+#undef glUniform4f
+#define glUniform4f GLTrace_glUniform4f
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv GLTrace_glUniformMatrix4fv
+#undef glBufferData
+#define glBufferData GLTrace_glBufferData
+#undef glBufferSubData
+#define glBufferSubData GLTrace_glBufferSubData
+#undef glClear
+#define glClear GLTrace_glClear
+#undef glClearBufferfv
+#define glClearBufferfv GLTrace_glClearBufferfv
+#undef glCopyTexSubImage2D
+#define glCopyTexSubImage2D GLTrace_glCopyTexSubImage2D
+#undef glClearColor
+#define glClearColor GLTrace_glClearColor
+#undef glDrawArrays
+#define glDrawArrays GLTrace_glDrawArrays
+#undef glDrawArraysInstanced
+#define glDrawArraysInstanced GLTrace_glDrawArraysInstanced
+#undef glDrawArraysInstancedBaseInstance
+#define glDrawArraysInstancedBaseInstance GLTrace_glDrawArraysInstancedBaseInstance
+#undef glMultiDrawArraysIndirect
+#define glMultiDrawArraysIndirect GLTrace_glMultiDrawArraysIndirect
+
+#else
+
+inline void glTraceEndFrame() {}
+inline void glTraceReport() {}
+
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+//Accuracy and throughput of the integrators in Force_Pipeline.h
+//  g++ -O2 Integrator_Accuracy.cpp -o Integrator_Accuracy
+//  ./Integrator_Accuracy [--particles 20000] [--time 1.5] [--drag 0.5] [--tolerance 0.001]
+
+//Launches fountain like particles under gravity and linear drag, which has a closed form solution,
+//and steps them with every integrator at a range of dt. For each it prints the largest position error
+//against the closed form over the flight and the particle steps per second, then the biggest dt that
+//stays within the tolerance (in scene units), the step to use for offline renders.
+//--drag 0 is the plain ballistic case, where Verlet and RK4 are exact up to rounding.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "Force_Pipeline.h"
+
+using namespace std;
+
+static double now() {
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Position at time t of a particle leaving p0 with v0 under gravity g and drag k
+static glm::vec3 exactPosition(const glm::vec3& p0, const glm::vec3& v0, const glm::vec3& g, float k, double t) {
+	if (k == 0) return p0 + v0 * (float)t + g * (float)(0.5 * t * t);
+	glm::vec3 terminal = g / k;
+	return p0 + terminal * (float)t + (v0 - terminal) * (float)((1 - exp(-k * t)) / k);
+}
+
+struct Result {
+	double error, stepsPerSecond;
+};
+
+template <class Pipeline>
+Result run(const Pipeline& physics, float dt, float flight, const vector<glm::vec3>& p0, const vector<glm::vec3>& v0) {
+	vector<glm::vec3> position = p0, velocity = v0;
+	int steps = (int)(flight / dt + 0.5f);
+	double error = 0, busy = 0;
+	glm::vec3 g = physics.template stage<Gravity>().g;
+	float k = physics.template stage<Drag>().k;
+	for (int s = 1; s <= steps; s++) {
+		double start = now();
+		physics.step(dt, position, velocity);
+		busy += now() - start;
+		for (size_t i = 0; i < position.size(); i++) {
+			glm::vec3 d = position[i] - exactPosition(p0[i], v0[i], g, k, s * (double)dt);
+			double e = sqrt((double)glm::dot(d, d));
+			if (e > error) error = e;
+		}
+	}
+	Result r = { error, (double)steps * position.size() / busy };
+	return r;
+}
+
+int main(int argc, char* argv[]) {
+	int particles = 20000;
+	float flight = 1.5f, tolerance = 0.001f;
+	ForcePipeline<Gravity, Drag> physics;
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--particles") == 0) particles = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--time") == 0) flight = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--drag") == 0) physics.stage<Drag>().k = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--tolerance") == 0) tolerance = (float)atof(argv[++i]);
+	}
+
+	srand(5611);
+	vector<glm::vec3> p0(particles, glm::vec3(0.0f)), v0(particles);
+	for (int i = 0; i < particles; i++) {
+		v0[i] = glm::vec3(-1.0f + 2.0f * rand() / RAND_MAX, -1.0f + 2.0f * rand() / RAND_MAX, 4.0f + (float)rand() / RAND_MAX);
+	}
+
+	const char* names[] = { "euler", "verlet", "rk4" };
+	const float dts[] = { 1 / 240.0f, 1 / 120.0f, 1 / 60.0f, 1 / 30.0f, 1 / 15.0f, 1 / 8.0f };
+	const int numDts = sizeof(dts) / sizeof(dts[0]);
+	printf("%-8s %10s %14s %18s\n", "method", "dt", "max error", "particle steps/s");
+	for (int m = 0; m < 3; m++) {
+		physics.integrator = (Integrator)m;
+		float best = 0;
+		for (int d = 0; d < numDts; d++) {
+			Result r = run(physics, dts[d], flight, p0, v0);
+			printf("%-8s %10.5f %14.3e %18.3e\n", names[m], dts[d], r.error, r.stepsPerSecond);
+			if (r.error <= tolerance) best = dts[d];
+		}
+		if (best > 0) printf("%-8s biggest dt within %g: %.5f (%.1f steps/s of simulated time)\n\n", names[m], tolerance, best, 1 / best);
+		else printf("%-8s no dt within %g\n\n", names[m], tolerance);
+	}
+	return 0;
+}
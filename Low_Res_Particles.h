@@ -0,0 +1,167 @@
+//Particles rendered at half or quarter resolution
+//Include after glad and Shader_Manager.h. Dense particle scenes spend most of their time filling the same
+//pixels over and over, so with --lowres 2 (or 4) the particle pass goes into an offscreen target with a
+//quarter (or a sixteenth) of the pixels and is composited back onto the window afterwards.
+//  lowRes.load(shaders);                      //before shaders.finish()
+//  lowRes.init(screen_width, screen_height);  //after it
+//  draw and flush the opaque meshes, lowRes.begin(stats), draw and flush the particles, lowRes.end(stats)
+//begin() copies the window depth and downsamples it (nearest depth of each block) into the low resolution
+//depth buffer, so the candle or obstacle still hides the particles behind it. end() upsamples with
+//weights from both the bilinear position and how close each low resolution texel's scene depth is to the
+//window pixel's, so particles don't smear over the edges of the opaque meshes.
+//The offscreen target holds premultiplied color and, in alpha, how much of the scene shows through.
+
+#ifndef LOW_RES_PARTICLES_H
+#define LOW_RES_PARTICLES_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "Particle_Stats.h"
+
+struct LowResParticles {
+	bool enabled = false;
+	int divisor = 1; //2 = half, 4 = quarter resolution in each direction
+	int width = 0, height = 0, lowWidth = 0, lowHeight = 0;
+	GLuint fbo = 0, colorTex = 0, depthTex = 0, lowDepthTex = 0, sceneDepthTex = 0, vao = 0;
+	GLuint downProgram = 0, upProgram = 0;
+	GLboolean blendWasOn = GL_FALSE;
+
+	void load(ShaderManager& shaders) {
+		if (!enabled) return;
+		downProgram = shaders.load("vertexScreen.glsl", "fragmentDepthDown.glsl");
+		upProgram = shaders.load("vertexScreen.glsl", "fragmentUpsample.glsl");
+	}
+
+	static GLuint makeTexture(GLenum internalFormat, GLenum format, GLenum type, int w, int h) {
+		GLuint tex;
+		glGenTextures(1, &tex);
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format, type, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return tex;
+	}
+
+	//Creates the targets for a window of w x h, returns false (and turns itself off) if that fails
+	bool init(int w, int h) {
+		if (!enabled) return false;
+		width = w;
+		height = h;
+		lowWidth = (w + divisor - 1) / divisor;
+		lowHeight = (h + divisor - 1) / divisor;
+		sceneDepthTex = makeTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, w, h);
+		colorTex = makeTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, lowWidth, lowHeight);
+		lowDepthTex = makeTexture(GL_R32F, GL_RED, GL_FLOAT, lowWidth, lowHeight);
+		depthTex = makeTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, lowWidth, lowHeight);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, lowDepthTex, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTex, 0);
+		bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		glGenVertexArrays(1, &vao); //the full screen triangle has no attributes, but core GL wants a VAO
+		glUseProgram(downProgram);
+		glUniform1i(glGetUniformLocation(downProgram, "sceneDepth"), 0);
+		glUniform1i(glGetUniformLocation(downProgram, "divisor"), divisor);
+		glUseProgram(upProgram);
+		glUniform1i(glGetUniformLocation(upProgram, "particles"), 0);
+		glUniform1i(glGetUniformLocation(upProgram, "lowDepth"), 1);
+		glUniform1i(glGetUniformLocation(upProgram, "sceneDepth"), 2);
+		glUniform1i(glGetUniformLocation(upProgram, "divisor"), divisor);
+		glUseProgram(0);
+
+		if (!complete || downProgram == 0 || upProgram == 0) {
+			printf("ERROR: Low resolution particle target is not renderable, drawing at full resolution\n");
+			enabled = false;
+		}
+		return enabled;
+	}
+
+	//Switches to the low resolution target, call after the opaque meshes are drawn
+	void begin(ParticleStats& stats) {
+		glBindTexture(GL_TEXTURE_2D, sceneDepthTex);
+		glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height); //from the window, still bound
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glViewport(0, 0, lowWidth, lowHeight);
+
+		//scene depth into the depth buffer and, for the upsample, into lowDepthTex. The shader writes no
+		//alpha, so the demos' blending must not touch that copy.
+		blendWasOn = glIsEnabled(GL_BLEND);
+		glDisable(GL_BLEND);
+		GLenum downBuffers[2] = { GL_NONE, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, downBuffers);
+		glDepthFunc(GL_ALWAYS);
+		glUseProgram(downProgram);
+		glBindVertexArray(vao);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		stats.drew(3);
+		glDepthFunc(GL_LESS);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		GLenum particleBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_NONE };
+		glDrawBuffers(2, particleBuffers);
+		static const GLfloat clear[4] = { 0, 0, 0, 1 }; //nothing drawn, everything shows through
+		glClearBufferfv(GL_COLOR, 0, clear);
+
+		//over blending that keeps the color premultiplied and multiplies up the transmittance
+		glEnable(GL_BLEND);
+		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+	}
+
+	//Upsamples the particles onto the window and puts the demos' state back
+	void end(ParticleStats& stats) {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, width, height);
+		glBlendFunc(GL_ONE, GL_SRC_ALPHA);
+		glDisable(GL_DEPTH_TEST);
+
+		glUseProgram(upProgram);
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, sceneDepthTex);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, lowDepthTex);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, colorTex);
+		glBindVertexArray(vao);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		stats.drew(3);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glEnable(GL_DEPTH_TEST);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		if (!blendWasOn) glDisable(GL_BLEND);
+	}
+
+	void deleteBuffers() {
+		if (fbo == 0) return;
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteTextures(1, &colorTex);
+		glDeleteTextures(1, &depthTex);
+		glDeleteTextures(1, &lowDepthTex);
+		glDeleteTextures(1, &sceneDepthTex);
+		glDeleteVertexArrays(1, &vao);
+	}
+};
+
+//--lowres 2 or --lowres 4
+inline void LowResParseArgs(LowResParticles& lowRes, int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--lowres") == 0 && i + 1 < argc) {
+			lowRes.divisor = atoi(argv[++i]);
+			if (lowRes.divisor != 2 && lowRes.divisor != 4) {
+				fprintf(stderr, "ERROR: --lowres takes 2 or 4\n");
+				lowRes.divisor = 1;
+			}
+			lowRes.enabled = lowRes.divisor > 1;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,191 @@
+//One vertex buffer for all the static meshes of a scene
+//Include after glad and glm. addMesh() appends a mesh file (the sphere.txt format: the number of floats,
+//then 8 per vertex: position, uv, normal) to the arena and upload() puts everything in one VBO behind
+//one VAO, so any mix of meshes can be drawn with a single glMultiDrawArraysIndirect. Files that keep the
+//attributes in another order (snow.txt: position, normal, uv) pass their MeshLayout to addMesh().
+//The VAO also carries the per instance attributes of the INSTANCED shader variant, read from a streamed
+//instance buffer; every indirect command's baseInstance points at its slice of that buffer.
+//Attribute locations are fixed in vertex.glsl, so every program can use the same VAO.
+//The meshes are plain triangle lists without shared vertices, so there is no index buffer.
+
+#ifndef MESH_ARENA_H
+#define MESH_ARENA_H
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include "Particle_Stats.h"
+
+//layout(location) values in vertex.glsl
+#define ATTRIB_POSITION 0
+#define ATTRIB_TEXCOORD 1
+#define ATTRIB_NORMAL 2
+#define ATTRIB_INST_CENTER_RADIUS 3
+#define ATTRIB_INST_COLOR 4
+#define ATTRIB_INST_EXTRA 5 //a third instance attribute, only the COMPACT variant has one
+
+#define MESH_VERTEX_FLOATS 8 //per vertex in mesh files and the arena: position 3, uv 2, normal 3
+
+//Where a mesh file keeps each attribute among a vertex's floats
+struct MeshLayout {
+	int position, texcoord, normal;
+};
+const MeshLayout MESH_POSITION_UV_NORMAL = { 0, 3, 5 }; //the arena's own
+const MeshLayout MESH_POSITION_NORMAL_UV = { 0, 6, 3 };
+
+//A range of vertices in a VAO
+struct MeshRange {
+	GLuint vao;
+	GLint first;
+	GLsizei count;
+};
+
+struct DrawArraysIndirectCommand { //layout fixed by GL
+	GLuint count;
+	GLuint instanceCount;
+	GLuint first;
+	GLuint baseInstance;
+};
+
+struct ArenaInstance {
+	glm::vec4 centerRadius; //xyz = translation, w = scale
+	glm::vec4 color;        //rgb, a = alpha
+};
+
+struct MeshArena {
+	GLuint vao = 0, vbo = 0, instanceBuffer = 0, commandBuffer = 0;
+	std::vector<float> vertices; //only until upload()
+	std::vector<MeshRange> meshes;
+
+	//filled for every multi draw, kept so their memory is reused
+	std::vector<ArenaInstance> instances;
+	std::vector<DrawArraysIndirectCommand> commands;
+
+	//Returns the mesh's index, -1 if the file could not be read
+	int addMesh(const char* fileName, const MeshLayout& layout = MESH_POSITION_UV_NORMAL) {
+		std::ifstream modelFile(fileName);
+		int numLines = 0;
+		modelFile >> numLines;
+		if (!modelFile || numLines <= 0 || numLines % MESH_VERTEX_FLOATS != 0) {
+			printf("ERROR: Failed to read mesh %s\n", fileName);
+			return -1;
+		}
+		size_t start = vertices.size();
+		vertices.resize(start + numLines);
+		for (int v = 0; v < numLines; v += MESH_VERTEX_FLOATS) {
+			float in[MESH_VERTEX_FLOATS];
+			for (int i = 0; i < MESH_VERTEX_FLOATS; i++) modelFile >> in[i];
+			float* out = &vertices[start + v];
+			for (int i = 0; i < 3; i++) out[MESH_POSITION_UV_NORMAL.position + i] = in[layout.position + i];
+			for (int i = 0; i < 2; i++) out[MESH_POSITION_UV_NORMAL.texcoord + i] = in[layout.texcoord + i];
+			for (int i = 0; i < 3; i++) out[MESH_POSITION_UV_NORMAL.normal + i] = in[layout.normal + i];
+		}
+		MeshRange mesh;
+		mesh.vao = 0; //set by upload()
+		mesh.first = start / MESH_VERTEX_FLOATS;
+		mesh.count = numLines / MESH_VERTEX_FLOATS;
+		meshes.push_back(mesh);
+		return meshes.size() - 1;
+	}
+
+	const MeshRange& mesh(int index) const { return meshes[index]; }
+
+	void upload() {
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+
+		glGenBuffers(1, &vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), 0);
+		glEnableVertexAttribArray(ATTRIB_POSITION);
+		glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+		glVertexAttribPointer(ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), (void*)(5 * sizeof(float)));
+		glEnableVertexAttribArray(ATTRIB_NORMAL);
+
+		glGenBuffers(1, &instanceBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		glVertexAttribPointer(ATTRIB_INST_CENTER_RADIUS, 4, GL_FLOAT, GL_FALSE, sizeof(ArenaInstance), 0);
+		glVertexAttribDivisor(ATTRIB_INST_CENTER_RADIUS, 1);
+		glEnableVertexAttribArray(ATTRIB_INST_CENTER_RADIUS);
+		glVertexAttribPointer(ATTRIB_INST_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(ArenaInstance), (void*)sizeof(glm::vec4));
+		glVertexAttribDivisor(ATTRIB_INST_COLOR, 1);
+		glEnableVertexAttribArray(ATTRIB_INST_COLOR);
+
+		glGenBuffers(1, &commandBuffer);
+		glBindVertexArray(0);
+
+		for (size_t i = 0; i < meshes.size(); i++) meshes[i].vao = vao;
+		std::vector<float>().swap(vertices);
+		instances.reserve(4096);
+		commands.reserve(64);
+	}
+
+	//Starts a new multi draw
+	void begin() {
+		instances.clear();
+		commands.clear();
+	}
+
+	//Adds one instance of the mesh that starts at first, consecutive instances of a mesh share a command
+	void add(GLint first, GLsizei count, const glm::vec4& centerRadius, const glm::vec4& color) {
+		if (commands.empty() || commands.back().first != (GLuint)first) {
+			DrawArraysIndirectCommand command = { (GLuint)count, 0, (GLuint)first, (GLuint)instances.size() };
+			commands.push_back(command);
+		}
+		commands.back().instanceCount++;
+		ArenaInstance instance = { centerRadius, color };
+		instances.push_back(instance);
+	}
+
+	//Adds a command for n instances that are already in the instance buffer at baseInstance, merged into
+	//the previous command when it is the same mesh and its instances end there
+	void addCommand(GLint first, GLsizei count, GLuint baseInstance, GLuint n) {
+		DrawArraysIndirectCommand* last = commands.empty() ? NULL : &commands.back();
+		if (last && last->first == (GLuint)first && last->baseInstance + last->instanceCount == baseInstance) {
+			last->instanceCount += n;
+			return;
+		}
+		DrawArraysIndirectCommand command = { (GLuint)count, n, (GLuint)first, baseInstance };
+		commands.push_back(command);
+	}
+
+	//Fills the instance buffer for the commands that follow, returns the number of bytes uploaded
+	size_t uploadInstances(const ArenaInstance* data, size_t n) {
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		glBufferData(GL_ARRAY_BUFFER, n * sizeof(ArenaInstance), data, GL_STREAM_DRAW);
+		return n * sizeof(ArenaInstance);
+	}
+
+	//Uploads the commands and draws them all from the instance buffer as it is, the arena VAO has to be
+	//bound. Returns the number of bytes uploaded.
+	size_t drawCommands(ParticleStats& stats) {
+		if (commands.empty()) return 0;
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawArraysIndirectCommand), commands.data(), GL_STREAM_DRAW);
+		glMultiDrawArraysIndirect(GL_TRIANGLES, 0, commands.size(), 0);
+
+		long long triangles = 0;
+		for (size_t i = 0; i < commands.size(); i++) triangles += (long long)(commands[i].count / 3) * commands[i].instanceCount;
+		stats.drewMulti(triangles);
+		return commands.size() * sizeof(DrawArraysIndirectCommand);
+	}
+
+	//Uploads the instances and commands and draws them all, the arena VAO has to be bound.
+	//Returns the number of bytes uploaded.
+	size_t draw(ParticleStats& stats) {
+		if (commands.empty()) return 0;
+		size_t bytes = uploadInstances(instances.data(), instances.size());
+		return bytes + drawCommands(stats);
+	}
+
+	void deleteBuffers() {
+		glDeleteBuffers(1, &vbo);
+		glDeleteBuffers(1, &instanceBuffer);
+		glDeleteBuffers(1, &commandBuffer);
+		glDeleteVertexArrays(1, &vao);
+	}
+};
+
+#endif
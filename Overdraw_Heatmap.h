@@ -0,0 +1,139 @@
+//Overdraw heatmap of the particle pass, a debug view of where the fill rate goes
+//Include after glad and Shader_Manager.h. With --overdraw (or the "h" key) the particles are drawn with
+//the OVERDRAW variant of fragment.glsl, which only adds 1 per fragment into a float target. end() reads
+//the counts back for the max and average fragments per covered pixel (printed with --stats, in the CSV
+//and on the overlay) and replaces the frame with the counts color mapped: blue for 1, through green and
+//yellow to red at scale, white above it, black where no particle was drawn.
+//The depth state is the demo's own and the window depth is copied in first, so the counts are the
+//fragments the normal full resolution pass shades, after the opaque meshes and early depth rejection.
+//  heatmap.load(shaders);                      //before shaders.finish()
+//  heatmap.init(screen_width, screen_height);  //after it
+//  draw and flush the opaque meshes, heatmap.begin(), draw the particles with heatmap.countProgram and
+//  flush, heatmap.end(stats)
+//The read back stalls the pipeline, fine for a debug view. Works headless, e.g. with --benchmark.
+
+#ifndef OVERDRAW_HEATMAP_H
+#define OVERDRAW_HEATMAP_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Particle_Stats.h"
+
+struct OverdrawHeatmap {
+	bool enabled = false;   //--overdraw or the "h" key
+	bool supported = false;
+	float scale = 16;       //fragments per pixel shown red
+	int width = 0, height = 0;
+	GLuint fbo = 0, countTex = 0, depthTex = 0, vao = 0;
+	GLuint countProgram = 0, heatmapProgram = 0;
+	GLint uniScale = -1;
+	GLboolean blendWasOn = GL_FALSE;
+	std::vector<float> counts; //read back every frame
+
+	//The counting program is the particle shader pair with OVERDRAW added to its defines
+	void load(ShaderManager& shaders, const char* vsFile = "vertex.glsl", const char* fsFile = "fragment.glsl", const char* defines = "#define INSTANCED") {
+		countProgram = shaders.load(vsFile, fsFile, (std::string(defines) + "\n#define OVERDRAW").c_str());
+		heatmapProgram = shaders.load("vertexScreen.glsl", "fragmentHeatmap.glsl");
+	}
+
+	static GLuint makeTexture(GLenum internalFormat, GLenum format, GLenum type, int w, int h) {
+		GLuint tex;
+		glGenTextures(1, &tex);
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format, type, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		return tex;
+	}
+
+	bool init(int w, int h) {
+		width = w;
+		height = h;
+		countTex = makeTexture(GL_R32F, GL_RED, GL_FLOAT, w, h);
+		depthTex = makeTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, w, h);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, countTex, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTex, 0);
+		supported = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		glGenVertexArrays(1, &vao); //the full screen triangle has no attributes, but core GL wants a VAO
+		glUseProgram(heatmapProgram);
+		glUniform1i(glGetUniformLocation(heatmapProgram, "counts"), 0);
+		uniScale = glGetUniformLocation(heatmapProgram, "scale");
+		glUseProgram(0);
+
+		if (!supported || countProgram == 0 || heatmapProgram == 0) {
+			printf("ERROR: Overdraw heatmap target is not renderable, heatmap disabled\n");
+			supported = false;
+			enabled = false;
+		}
+		return supported;
+	}
+
+	//Starts counting, call after the opaque meshes are drawn to the window
+	void begin() {
+		glBindTexture(GL_TEXTURE_2D, depthTex);
+		glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height); //from the window, still bound
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		static const GLfloat zero[4] = { 0, 0, 0, 0 };
+		glClearBufferfv(GL_COLOR, 0, zero);
+
+		blendWasOn = glIsEnabled(GL_BLEND);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE);
+	}
+
+	//Reads the counts back into the stats and draws the heatmap over the whole window
+	void end(ParticleStats& stats) {
+		counts.resize((size_t)width * height);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glReadPixels(0, 0, width, height, GL_RED, GL_FLOAT, counts.data());
+		double fragments = 0;
+		int covered = 0, maxCount = 0;
+		for (size_t p = 0; p < counts.size(); p++) {
+			int n = (int)counts[p];
+			if (n == 0) continue;
+			fragments += n;
+			covered++;
+			if (n > maxCount) maxCount = n;
+		}
+		stats.overdraw(maxCount, covered > 0 ? (float)(fragments / covered) : 0.0f);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		glDisable(GL_BLEND);
+		glDisable(GL_DEPTH_TEST);
+		glUseProgram(heatmapProgram);
+		glUniform1f(uniScale, scale);
+		glBindTexture(GL_TEXTURE_2D, countTex);
+		glBindVertexArray(vao);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		stats.drew(3);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glEnable(GL_DEPTH_TEST);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		if (blendWasOn) glEnable(GL_BLEND);
+	}
+
+	void deleteBuffers() {
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteTextures(1, &countTex);
+		glDeleteTextures(1, &depthTex);
+		glDeleteVertexArrays(1, &vao);
+	}
+};
+
+inline void OverdrawParseArgs(OverdrawHeatmap& heatmap, int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--overdraw") == 0) heatmap.enabled = true;
+	}
+}
+
+#endif
@@ -20,6 +20,7 @@
 
 #include "stdafx.h"
 #include "glad/glad.h"  //Include order can matter here
+#include "GL_Trace.h"  //build with -DGL_TRACE to count GL calls per frame
 #ifndef _WIN32
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengl.h>
@@ -38,6 +39,16 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
+#include "Benchmark.h"
+#include "Stats_Overlay.h"
+#include "Perf_Counters.h"
+#include "Alloc_Tracker.h" //build with -DTRACK_ALLOCS to count heap allocations per frame
+#include "Shader_Manager.h"
+#include "Render_Queue.h"
+#include "Frustum_Cull.h"
+#include "Low_Res_Particles.h"
+#include "Overdraw_Heatmap.h"
+#include "Force_Pipeline.h"
 
 #include <fstream>
 using namespace std;
@@ -47,64 +58,38 @@ int screen_width = 800;
 int screen_height = 600;
 
 //changed 02/03/2018
-vector<glm::vec3>position;
-vector<glm::vec3>velocity;
-vector<glm::vec3>color;
-vector<float>lifespan;
+ParticleVector<glm::vec3>position;
+ParticleVector<glm::vec3>velocity;
+ParticleVector<float>lifespan;
+glm::vec3 waterColor = glm::vec3(0.7f, 0.7f, 1.0f); //the same for every drop, so it isn't stored per particle
 float radius = 0.02;
 float floorPos = -1.2;
 float obx=0, oby=0.5, obz=0., obr=0.25;
-
-// Shader sources
-const GLchar* vertexSource =
-"#version 150 core\n"
-"in vec3 position;"
-//"in vec3 inColor;"
-//the color will be changed in the OpenGL part
-//change the number of particles
-"uniform vec3 inColor;"
-"in vec3 inNormal;"
-"const vec3 inLightDir = normalize(vec3(0,2,2));"
-"out vec3 Color;"
-"out vec3 normal;"
-"out vec3 lightDir;"
-"uniform mat4 model;"
-"uniform mat4 view;"
-"uniform mat4 proj;"
-"void main() {"
-"   Color = inColor;"
-"   gl_Position = proj * view * model * vec4(position, 1.0);"
-"   vec4 norm4 = transpose(inverse(model)) * vec4(inNormal, 1.0);"
-"   normal = normalize(norm4.xyz);"
-"   lightDir = (view * vec4(inLightDir, 0)).xyz;"
-"}";
-
-const GLchar* fragmentSource =
-"#version 150 core\n"
-"in vec3 Color;"
-"in vec3 normal;"
-"in vec3 lightDir;"
-"out vec4 outColor;"
-"const float ambient = .2;"
-"void main() {"
-"   vec3 diffuseC = Color * max(dot(lightDir, normal), 0);"
-"   vec3 ambC = Color * ambient;"
-// the alpha channel of all pixels are 1.0, i.e. the opacity is 100%
-"   outColor = vec4(diffuseC+ambC, 1.0);"
-"}";
+ForcePipeline<Gravity, FloorPlane, SphereObstacle> physics; //parameters set in main
 
 bool fullscreen = false;
 void Win2PPM(int width, int height);
-void computePhysics(int i, float dt);
 float randf();
 
-//Index of where to model, view, and projection matricies are stored on the GPU
-GLint uniModel, uniView, uniProj, uniColor;
-
 float aspect; //aspect ratio (needs to be updated if the window is resized)
 
+Benchmark bench; //enabled with --benchmark, see Benchmark.h
+ParticleStats stats; //per frame counters, see Particle_Stats.h
+StatsOverlay overlay;
+PerfCounters perf; //--perf, hardware counters per frame phase
+RenderQueue queue; //draws sorted by state, see Render_Queue.h
+Frustum frustum; //particles outside the view are not drawn
+LowResParticles lowRes; //--lowres 2|4, particles at reduced resolution
+OverdrawHeatmap heatmap; //--overdraw, fragments per pixel of the particle pass
+
 int main(int argc, char *argv[]) {
 	SDL_Init(SDL_INIT_VIDEO);  //Initialize Graphics (for OpenGL)
+	StatsParseArgs(stats, argc, argv);
+	OverdrawParseArgs(heatmap, argc, argv);
+	IntegratorParseArgs(physics, argc, argv);
+	LowResParseArgs(lowRes, argc, argv);
+	PerfParseArgs(perf, argc, argv);
+	BenchmarkParseArgs(bench, "interactions", argc, argv);
 
 	//Ask SDL to get a recent version of OpenGL (3.2 or greater)
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -112,7 +97,7 @@ int main(int argc, char *argv[]) {
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 4);
 
 	//Create a window (offsetx, offsety, width, height, flags)
-	SDL_Window* window = SDL_CreateWindow("My OpenGL Program", 150, 50, screen_width, screen_height, SDL_WINDOW_OPENGL);
+	SDL_Window* window = SDL_CreateWindow("My OpenGL Program", 150, 50, screen_width, screen_height, SDL_WINDOW_OPENGL | (bench.enabled ? SDL_WINDOW_HIDDEN : 0));
 	aspect = screen_width / (float)screen_height; //aspect ratio (needs to be updated if the window is resized)
 
 	//The above window cannot be resized which makes some code slightly easier.
@@ -134,99 +119,29 @@ int main(int argc, char *argv[]) {
 		printf("ERROR: Failed to initialize OpenGL context.\n");
 		return -1;
 	}
-
-	//Build a Vertex Array Object. This stores the VBO and attribute mappings in one object
-	GLuint vao;
-	glGenVertexArrays(1, &vao); //Create a VAO
-	glBindVertexArray(vao); //Bind the above created VAO to the current context
-
-	ifstream modelFile;
-	modelFile.open("sphere.txt");
-	int numLines = 0;
-	modelFile >> numLines;
-	float *vertices = new float[numLines];
-	for (int i = 0; i < numLines; i++) {
-		modelFile >> vertices[i];
-	}
-	printf("wall numLines: %d\n", numLines);
-	int numVerts = numLines / 8;
-	modelFile.close();
-
-	//Allocate memory on the graphics card to store geometry (vertex buffer object)
-	GLuint vbo;
-	glGenBuffers(1, &vbo);  //Create 1 buffer called vbo
-	glBindBuffer(GL_ARRAY_BUFFER, vbo); //Set the vbo as the active array buffer (Only one buffer can be active at a time)
-	glBufferData(GL_ARRAY_BUFFER, numLines * sizeof(float), vertices, GL_STATIC_DRAW); //upload vertices to vbo
-	//GL_STATIC_DRAW means we won't change the geometry, GL_DYNAMIC_DRAW = geometry changes infrequently
-	//GL_STREAM_DRAW = geom. changes frequently.  This effects which types of GPU memory is used
-
-	//Load the vertex Shader
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexSource, NULL);
-	glCompileShader(vertexShader);
-
-	//Let's double check the shader compiled 
-	GLint status;
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-	if (!status) {
-		char buffer[512];
-		glGetShaderInfoLog(vertexShader, 512, NULL, buffer);
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
-			"Compilation Error",
-			"Failed to Compile: Check Consol Output.",
-			NULL);
-		printf("Vertex Shader Compile Failed. Info:\n\n%s\n", buffer);
-	}
-
-	//Load the fragment Shader
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-	glCompileShader(fragmentShader);
-
-	//Double check the shader compiled 
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-	if (!status) {
-		char buffer[512];
-		glGetShaderInfoLog(fragmentShader, 512, NULL, buffer);
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
-			"Compilation Error",
-			"Failed to Compile: Check Consol Output.",
-			NULL);
-		printf("Fragment Shader Compile Failed. Info:\n\n%s\n", buffer);
-	}
-
-	//Join the vertex and fragment shaders together into one program
-	GLuint shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	glBindFragDataLocation(shaderProgram, 0, "outColor"); // set output
-	glLinkProgram(shaderProgram); //run the linker
-
-	glUseProgram(shaderProgram); //Set the active shader (only one can be used at a time)
-
-	//Tell OpenGL how to set fragment shader input 
-	GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-	glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
-	//Attribute, vals/attrib., type, normalized?, stride, offset
-	//Binds to VBO current GL_ARRAY_BUFFER 
-	glEnableVertexAttribArray(posAttrib);
-
-	/*GLint colAttrib = glGetAttribLocation(shaderProgram, "inColor");
-	glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(colAttrib);*/
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	GLint normAttrib = glGetAttribLocation(shaderProgram, "inNormal");
-	glVertexAttribPointer(normAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
-	glEnableVertexAttribArray(normAttrib);
-
-	glBindVertexArray(0); //Unbind the VAO
-
-	//Where to model, view, and projection matricies are stored on the GPU
-	uniModel = glGetUniformLocation(shaderProgram, "model");
-	uniView = glGetUniformLocation(shaderProgram, "view");
-	uniProj = glGetUniformLocation(shaderProgram, "proj");
-	uniColor = glGetUniformLocation(shaderProgram, "inColor");
+	if (bench.enabled) SDL_GL_SetSwapInterval(0); //don't wait for vsync while benchmarking
+	StatsOverlayInit(overlay);
+
+	//All meshes share one vertex buffer and VAO so the whole frame is one multi draw (see Mesh_Arena.h)
+	MeshArena arena;
+	int sphereMesh = arena.addMesh("sphere.txt");
+	if (sphereMesh < 0) return -1;
+	arena.upload();
+	MeshRange sphere = arena.mesh(sphereMesh);
+
+	//Load the shaders from vertex.glsl and fragment.glsl (or the binary cache, see Shader_Manager.h)
+	ShaderManager shaders;
+	GLuint shaderProgram = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED"); //meshes are only moved and scaled
+	lowRes.load(shaders);
+	heatmap.load(shaders);
+	shaders.finish();
+	heatmap.init(screen_width, screen_height);
+	lowRes.init(screen_width, screen_height);
+
+	//The queue looks up the uniforms and points every program at the shared camera buffer
+	queue.init(&arena);
+	queue.addProgram(shaderProgram);
+	queue.addProgram(heatmap.countProgram);
 
 	glEnable(GL_DEPTH_TEST);
 
@@ -234,7 +149,11 @@ int main(int argc, char *argv[]) {
 	SDL_Event windowEvent;
 	bool quit = false;
 
-	srand(time(NULL));
+	srand(bench.enabled ? bench.seed : time(NULL));
+	physics.stage<FloorPlane>().height = floorPos + radius;
+	physics.stage<SphereObstacle>().center = glm::vec3(obx, oby, obz);
+	physics.stage<SphereObstacle>().radius = obr / 2 + radius; //the sphere mesh has radius 0.5, plus the drop's own
+	physics.maxTravel = obr / 2; //slow frames substep the fast drops, the swept test alone keeps them out of the obstacle
 
 	//particle system start here
 	//generate the emitter shape
@@ -262,6 +181,10 @@ int main(int argc, char *argv[]) {
 				quit = true; ; //Exit event loop
 			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_f) //If "f" is pressed
 				fullscreen = !fullscreen;
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_i) //"i" shows the stats overlay
+				overlay.visible = !overlay.visible;
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_h) //"h" shows the overdraw heatmap
+				heatmap.enabled = heatmap.supported && !heatmap.enabled;
 			SDL_SetWindowFullscreen(window, fullscreen ? SDL_WINDOW_FULLSCREEN : 0); //Set to full screen 
 		}
 
@@ -273,17 +196,20 @@ int main(int argc, char *argv[]) {
 		if (dt > .1) dt = .1; //Have some max dt
 		lastTime = SDL_GetTicks() / 1000.f;
 		if (saveOutput) dt += .07; //Fix framerate at 14 FPS
+		if (bench.enabled) dt = bench.dt; //fixed step so benchmark runs are comparable
 
 		glm::mat4 view = glm::lookAt(
 			glm::vec3(3.f, 0.f, 0.f),  //Cam Position
 			glm::vec3(0.0f, 0.0f, 0.0f),  //Look at point
 			glm::vec3(0.0f, 0.0f, 1.0f)); //Up
-		GLint uniView = glGetUniformLocation(shaderProgram, "view");
-		glUniformMatrix4fv(uniView, 1, GL_FALSE, glm::value_ptr(view));
 
 		glm::mat4 proj = glm::perspective(3.14f / 4, aspect, 1.0f, 10.0f); //FOV, aspect, near, far
-		GLint uniProj = glGetUniformLocation(shaderProgram, "proj");
-		glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(proj));
+		queue.setCamera(view, proj);
+		frustum.update(proj * view);
+		stats.uploaded(2 * sizeof(glm::mat4));
+
+		bench.beginFrame();
+		perf.begin(PHASE_SIMULATE);
 
 		//Partical birthrate
 		float numParticles = PARTICLE_NUM * dt;
@@ -296,57 +222,81 @@ int main(int argc, char *argv[]) {
 		}
 
 
-		glm::mat4 model2(1.0f);
-		model2 = glm::translate(model2, glm::vec3(obx, oby, obz));
-		model2 = glm::scale(model2, glm::vec3(obr));
-		glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model2));
-		glDrawArrays(GL_TRIANGLES, 0, numVerts);
-
 		//generate new particles
 		for (int i = 0; i < numParticles; i++) {
 			//choose random particle location
 			position.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
 			//choose random particle velocity
 			velocity.push_back(glm::vec3(-1.0f + randf() * 2, 4.0f + randf(), -1.0f + randf() * 2));
-			color.push_back(glm::vec3(0.7f, 0.7f, 1.0f));
 			lifespan.push_back(maxLifeSpan);
 		}
+		stats.born(numParticles);
 
+		//update the particles, dead ones are removed before anything is drawn
 		for (int i = 0; i < position.size(); i++) {
 			lifespan[i] -= dt;
-			glm::vec3 inColor = color[i];
-			glUniform3f(uniColor, inColor.r, inColor.g, inColor.b);
-
-			glm::mat4 model(1.0f);
-			if (lifespan[i] <= 0) {// draw the "alive" particles
+			if (lifespan[i] <= 0) {
 				position.erase(position.begin() + i);
 				velocity.erase(velocity.begin() + i);
-				color.erase(color.begin() + i);
 				lifespan.erase(lifespan.begin() + i);
+				stats.died();
+				i--;
 			}
-			model = glm::translate(model, position[i]);
-			model = glm::scale(model, glm::vec3(radius));
-			glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
-
-			computePhysics(i, dt);
-
-			glBindVertexArray(vao);
-			glDrawArrays(GL_TRIANGLES, 0, numVerts); //(Primitives, Which VBO, Number of vertices)
+		}
+		physics.step(dt, position, velocity);
+		bench.endSimulate(position.size());
+		perf.end(PHASE_SIMULATE);
+		perf.begin(PHASE_RENDER);
+
+		//draw the obstacle
+		queue.submit(shaderProgram, sphere, glm::vec3(obx, oby, obz), obr, glm::vec3(0.7f, 0.7f, 1.0f));
+
+		//draw the "alive" particles that can be on screen
+		stats.culled(frustum.cull(position, radius));
+		if (heatmap.enabled || lowRes.enabled) queue.flush(stats); //the obstacle first, the particles are tested against its depth
+		if (heatmap.enabled) heatmap.begin(); //counts the full resolution pass
+		else if (lowRes.enabled) lowRes.begin(stats);
+		GLuint particleProgram = heatmap.enabled ? heatmap.countProgram : shaderProgram;
+		for (size_t v = 0; v < frustum.visible.size(); v++) {
+			int i = frustum.visible[v];
+			queue.submit(particleProgram, sphere, position[i], radius, waterColor);
+		}
+		queue.flush(stats); //one multi draw for everything above
+		if (heatmap.enabled) heatmap.end(stats);
+		else if (lowRes.enabled) lowRes.end(stats);
+
+		if (bench.enabled) glFinish(); //count the GPU work in the render phase
+		perf.end(PHASE_RENDER);
+		perf.endFrame();
+		bench.endRender();
+		if (bench.done()) {
+			bench.report();
+			quit = true;
 		}
 		
 		if (saveOutput) Win2PPM(screen_width, screen_height);
 
+		stats.endFrame(position.size());
+		StatsOverlayDraw(overlay, stats, screen_width, screen_height);
+		allocTracker.endFrame();
+		glTraceEndFrame();
+
 		SDL_GL_SwapWindow(window); //Double buffering
 	}
 
 	//Clean Up
-	glDeleteProgram(shaderProgram);
-	glDeleteShader(fragmentShader);
-	glDeleteShader(vertexShader);
+	shaders.deleteAll();
+	queue.deleteBuffer();
 
-	glDeleteBuffers(1, &vbo);
+	arena.deleteBuffers();
+	heatmap.deleteBuffers();
+	lowRes.deleteBuffers();
 
-	glDeleteVertexArrays(1, &vao);
+	StatsOverlayDelete(overlay);
+	stats.close();
+	allocTracker.report();
+	perf.report();
+	glTraceReport();
 
 	SDL_GL_DeleteContext(context);
 	SDL_Quit();
@@ -357,31 +307,6 @@ float randf() {
 	return (float)(rand() % 1001) * 0.001f;
 }
 
-void computePhysics(int i, float dt) {
-	glm::vec3 acceleration = glm::vec3(0.0f,0.0f,-10.0f);//-9.8;
-	velocity[i] = velocity[i] + acceleration * dt;
-	position[i] = position[i] + velocity[i] * dt;
-	//printf("pos: (%.2f,%.2f,%.2f)\nvel: (%.2f,%.2f,%.2f)\n", position.x, position.y, position.z, velocity.x, velocity.y, velocity.z);
-	if ((position[i].z - radius) < floorPos) {
-		position[i].z = floorPos + radius;
-		velocity[i].z *= -.95;
-	}
-
-	if (sqrt((position[i].x - obx)*(position[i].x - obx) + (position[i].y - oby)*(position[i].y - oby) + (position[i].z - obz)*(position[i].z - obz))<(obr/2)) {
-		glm::vec3 normal = glm::vec3(position[i].x-obx, position[i].y-oby, position[i].z-obz);
-		float length = sqrt((position[i].x - obx)*(position[i].x - obx) + (position[i].y - oby)*(position[i].y - oby) + (position[i].z - obz)*(position[i].z - obz));
-		normal = glm::vec3(normal.x / length, normal.y / length, normal.z / length);
-		position[i] = glm::vec3(obx + normal.x*obr*1.01/2, oby + normal.y*obr*1.01/2, obz + normal.z*obr*1.01/2);
-		float lengthNormal = velocity[i].x*normal.x + velocity[i].y*normal.y + velocity[i].z*normal.z;
-		glm::vec3 vNorm = lengthNormal*normal;
-		velocity[i] = velocity[i] - vNorm;
-		velocity[i] = velocity[i] - vNorm*0.7f;
-	}
-
-
-}
-
-
 void calculate(float a, float b,float c) {
 	sqrt((a - obx)*(a - obx) + (b - oby)*(b - oby) + (c - obz)*(c - obz));
 }
@@ -395,7 +320,7 @@ void Win2PPM(int width, int height) {
 	unsigned char *image;
 
 	/* Allocate our buffer for the image */
-	image = (unsigned char *)malloc(3 * width*height * sizeof(char));
+	image = new (nothrow) unsigned char[3 * width*height];
 	if (image == NULL) {
 		fprintf(stderr, "ERROR: Failed to allocate memory for image\n");
 	}
@@ -420,7 +345,7 @@ void Win2PPM(int width, int height) {
 		}
 	}
 
-	free(image);
+	delete[] image;
 	fclose(fptr);
 	counter++;
 }
\ No newline at end of file
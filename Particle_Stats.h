@@ -0,0 +1,114 @@
+//Per frame counters for the particle demos
+//  --stats            print the counters to stdout once per second
+//  --stats-csv file   write one CSV row per frame
+//The demos bump the counters where particles are spawned/killed and where they draw or upload,
+//Stats_Overlay.h shows the last finished frame on screen
+
+#ifndef PARTICLE_STATS_H
+#define PARTICLE_STATS_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+struct FrameStats {
+	int alive = 0;          //particles alive at the end of the frame
+	int births = 0;         //particles spawned this frame
+	int deaths = 0;         //particles killed this frame
+	int offscreen = 0;      //particles culled outside the view frustum, not uploaded or drawn
+	int drawCalls = 0;
+	long long triangles = 0;
+	long long bytesUploaded = 0; //uniforms and buffer data sent to the GPU
+	double frameMs = 0;     //wall time since the previous frame ended
+	int overdrawMax = 0;    //most particle fragments on one pixel, only with the heatmap (Overdraw_Heatmap.h)
+	float overdrawAvg = 0;  //particle fragments per pixel the particles cover
+};
+
+struct ParticleStats {
+	FrameStats frame; //being counted
+	FrameStats last;  //the last finished frame
+	long long frameNumber = 0;
+
+	bool printStdout = false;
+	double printInterval = 1.0; //seconds between stdout lines
+	FILE* csv = NULL;
+
+	double lastFrameEnd = 0, lastPrint = 0;
+	int framesSincePrint = 0;
+	double msSincePrint = 0;
+
+	static double now() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void born(int n = 1) { frame.births += n; }
+	void died(int n = 1) { frame.deaths += n; }
+	void culled(int n) { frame.offscreen += n; }
+	void drew(int numVerts, int instances = 1) {
+		frame.drawCalls++;
+		frame.triangles += (long long)(numVerts / 3) * instances;
+	}
+	void drewMulti(long long triangles) { //one multi draw call covering many meshes/instances
+		frame.drawCalls++;
+		frame.triangles += triangles;
+	}
+	void uploaded(size_t bytes) { frame.bytesUploaded += bytes; }
+	void overdraw(int maxFragments, float avgFragments) {
+		frame.overdrawMax = maxFragments;
+		frame.overdrawAvg = avgFragments;
+	}
+
+	//Finishes the frame, feeds the sinks and starts counting the next one
+	void endFrame(size_t alive) {
+		double t = now();
+		frame.alive = alive;
+		frame.frameMs = lastFrameEnd > 0 ? (t - lastFrameEnd) * 1000 : 0;
+		lastFrameEnd = t;
+
+		if (csv) {
+			fprintf(csv, "%lld,%.3f,%d,%d,%d,%d,%lld,%lld,%d,%d,%.3f\n", frameNumber, frame.frameMs, frame.alive,
+				frame.births, frame.deaths, frame.drawCalls, frame.triangles, frame.bytesUploaded, frame.offscreen,
+				frame.overdrawMax, frame.overdrawAvg);
+		}
+		if (printStdout) {
+			framesSincePrint++;
+			msSincePrint += frame.frameMs;
+			if (lastPrint == 0) lastPrint = t;
+			if (t - lastPrint >= printInterval) {
+				printf("frame %lld: %.2f ms avg, alive %d, culled %d, born %d, died %d, draws %d, tris %lld, uploaded %.1f KB",
+					frameNumber, msSincePrint / framesSincePrint, frame.alive, frame.offscreen, frame.births, frame.deaths,
+					frame.drawCalls, frame.triangles, frame.bytesUploaded / 1024.0);
+				if (frame.overdrawMax > 0) printf(", overdraw max %d avg %.2f", frame.overdrawMax, frame.overdrawAvg);
+				printf("\n");
+				lastPrint = t;
+				framesSincePrint = 0;
+				msSincePrint = 0;
+			}
+		}
+
+		last = frame;
+		frame = FrameStats();
+		frameNumber++;
+	}
+
+	void close() {
+		if (csv) fclose(csv);
+		csv = NULL;
+	}
+};
+
+inline void StatsParseArgs(ParticleStats& stats, int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--stats") == 0) stats.printStdout = true;
+		if (strcmp(argv[i], "--stats-csv") == 0 && i + 1 < argc) {
+			stats.csv = fopen(argv[++i], "w");
+			if (stats.csv == NULL) {
+				fprintf(stderr, "ERROR: Failed to open %s for the stats\n", argv[i]);
+				continue;
+			}
+			fprintf(stats.csv, "frame,frame_ms,alive,births,deaths,draw_calls,triangles,bytes_uploaded,culled,overdraw_max,overdraw_avg\n");
+		}
+	}
+}
+
+#endif
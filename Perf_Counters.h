@@ -0,0 +1,182 @@
+//Hardware performance counters around the frame phases (Linux only)
+//  --perf    count cycles, instructions, L1D read misses, LLC misses and branch misses
+//The counters are read with perf_event_open at the start and end of each phase, so the numbers are for
+//this thread only and include the GL driver work done on it. Every second (and at exit) a table with
+//the per frame average of each phase is printed next to the phase time.
+//If the kernel refuses a counter (VMs, perf_event_paranoid) it is reported as "-" and the rest still work.
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum FramePhase { PHASE_SIMULATE, PHASE_RENDER, PHASE_COUNT };
+static const char* framePhaseNames[PHASE_COUNT] = { "simulate", "render" };
+
+enum PerfCounter { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_L1D_MISSES, PERF_LLC_MISSES, PERF_BRANCH_MISSES, PERF_COUNTER_COUNT };
+static const char* perfCounterNames[PERF_COUNTER_COUNT] = { "cycles", "instr", "L1D miss", "LLC miss", "br miss" };
+
+struct PerfPhase {
+	double seconds = 0;
+	uint64_t counts[PERF_COUNTER_COUNT] = {};
+	long long frames = 0;
+};
+
+struct PerfCounters {
+	bool enabled = false;
+	int fd[PERF_COUNTER_COUNT];
+	int slot[PERF_COUNTER_COUNT]; //position of each counter in the group read, -1 if it did not open
+	int numOpen = 0;
+	double printInterval = 1.0;
+
+	PerfPhase phases[PHASE_COUNT]; //since the last print
+	PerfPhase totals[PHASE_COUNT];
+	uint64_t startCounts[PERF_COUNTER_COUNT];
+	double startTime = 0, lastPrint = 0;
+
+	static double now() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+#ifdef __linux__
+	static int openCounter(uint32_t type, uint64_t config, int groupFd) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = groupFd == -1; //the leader starts the whole group
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+		return syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+	}
+
+	bool open() {
+		const uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		uint32_t types[PERF_COUNTER_COUNT] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+		uint64_t configs[PERF_COUNTER_COUNT] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, l1dReadMiss, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+		numOpen = 0;
+		int leader = -1;
+		for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+			fd[c] = openCounter(types[c], configs[c], leader);
+			slot[c] = fd[c] >= 0 ? numOpen++ : -1;
+			if (c == 0 && fd[c] < 0) {
+				fprintf(stderr, "ERROR: perf_event_open failed, hardware counters disabled (check /proc/sys/kernel/perf_event_paranoid)\n");
+				enabled = false;
+				return false;
+			}
+			if (c == 0) leader = fd[c];
+		}
+		ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		return true;
+	}
+
+	void read(uint64_t* counts) {
+		uint64_t buffer[1 + PERF_COUNTER_COUNT]; //nr followed by the values
+		if (::read(fd[0], buffer, sizeof(buffer)) < (ssize_t)sizeof(uint64_t)) return;
+		for (int c = 0; c < PERF_COUNTER_COUNT; c++) counts[c] = slot[c] >= 0 ? buffer[1 + slot[c]] : 0;
+	}
+
+	void close() {
+		if (!enabled) return;
+		for (int c = PERF_COUNTER_COUNT - 1; c >= 0; c--) {
+			if (fd[c] >= 0) ::close(fd[c]);
+		}
+		enabled = false;
+	}
+#else
+	bool open() {
+		fprintf(stderr, "Hardware counters are only available on Linux\n");
+		enabled = false;
+		return false;
+	}
+	void read(uint64_t* counts) { memset(counts, 0, sizeof(uint64_t) * PERF_COUNTER_COUNT); }
+	void close() {}
+#endif
+
+	void begin(FramePhase) {
+		if (!enabled) return;
+		read(startCounts);
+		startTime = now();
+	}
+
+	void end(FramePhase phase) {
+		if (!enabled) return;
+		uint64_t counts[PERF_COUNTER_COUNT];
+		read(counts);
+		PerfPhase& p = phases[phase];
+		p.seconds += now() - startTime;
+		for (int c = 0; c < PERF_COUNTER_COUNT; c++) p.counts[c] += counts[c] - startCounts[c];
+		p.frames++;
+	}
+
+	//call once per frame after the last phase
+	void endFrame() {
+		if (!enabled) return;
+		double t = now();
+		if (lastPrint == 0) lastPrint = t;
+		if (t - lastPrint < printInterval) return;
+		print(phases, "last second");
+		for (int i = 0; i < PHASE_COUNT; i++) {
+			PerfPhase& total = totals[i];
+			total.seconds += phases[i].seconds;
+			total.frames += phases[i].frames;
+			for (int c = 0; c < PERF_COUNTER_COUNT; c++) total.counts[c] += phases[i].counts[c];
+			phases[i] = PerfPhase();
+		}
+		lastPrint = t;
+	}
+
+	void print(const PerfPhase* table, const char* label) const {
+		printf("%-10s %9s", "phase", "ms/frame");
+		for (int c = 0; c < PERF_COUNTER_COUNT; c++) printf(" %12s", perfCounterNames[c]);
+		printf(" %6s   (per frame, %s)\n", "IPC", label);
+		for (int i = 0; i < PHASE_COUNT; i++) {
+			const PerfPhase& p = table[i];
+			double n = p.frames > 0 ? p.frames : 1;
+			printf("%-10s %9.3f", framePhaseNames[i], p.seconds * 1000 / n);
+			for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+				if (slot[c] < 0) printf(" %12s", "-");
+				else printf(" %12.0f", p.counts[c] / n);
+			}
+			double cycles = p.counts[PERF_CYCLES];
+			printf(" %6.2f\n", cycles > 0 ? p.counts[PERF_INSTRUCTIONS] / cycles : 0.0);
+		}
+	}
+
+	void report() {
+		if (!enabled) return;
+		for (int i = 0; i < PHASE_COUNT; i++) { //fold in the part since the last print
+			totals[i].seconds += phases[i].seconds;
+			totals[i].frames += phases[i].frames;
+			for (int c = 0; c < PERF_COUNTER_COUNT; c++) totals[i].counts[c] += phases[i].counts[c];
+		}
+		printf("\n");
+		print(totals, "whole run");
+		close();
+	}
+};
+
+inline void PerfParseArgs(PerfCounters& perf, int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--perf") == 0) {
+			perf.enabled = true;
+			perf.open();
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,93 @@
+//Static regions baked into a 3D grid of bytes, so classifying a particle is one indexed load
+//Include after glm. bake() runs an exact classifier once at the center of every cell of a box, at() and
+//classify() then look particles up instead of testing shapes. Points outside the box (or NaN) get the
+//outside value, so the box has to cover everywhere the particles can be in something else.
+//classify() does 4 particles at a time with SSE2 computing the cell indices and the loads done as one
+//gather with AVX2 (when the compiler targets it, e.g. -mavx2) or 4 plain loads otherwise.
+//  grid.bake(lo, hi, 64, OUTSIDE, [&](const glm::vec3& p) { return ...; });
+//  grid.classify(position, regions);  //regions[i] for every particle
+
+#ifndef REGION_GRID_H
+#define REGION_GRID_H
+
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REGION_SSE
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#endif
+
+struct RegionGrid {
+	glm::vec3 lo, invCell; //box corner and cells per unit along each axis
+	int res = 0;
+	unsigned char outside = 0;
+	std::vector<unsigned char> cells; //x fastest, 3 bytes of padding so a 4 byte gather stays inside
+
+	template <class Classifier>
+	void bake(const glm::vec3& boxMin, const glm::vec3& boxMax, int resolution, unsigned char outsideValue, Classifier classify) {
+		lo = boxMin;
+		res = resolution;
+		outside = outsideValue;
+		glm::vec3 cell = (boxMax - boxMin) / (float)res;
+		invCell = glm::vec3(1.0f) / cell;
+		cells.assign(res * res * res + 3, outside);
+		for (int z = 0; z < res; z++) {
+			for (int y = 0; y < res; y++) {
+				for (int x = 0; x < res; x++) {
+					cells[(z * res + y) * res + x] = classify(lo + (glm::vec3(x, y, z) + 0.5f) * cell);
+				}
+			}
+		}
+	}
+
+	unsigned char at(const glm::vec3& p) const {
+		glm::vec3 f = (p - lo) * invCell;
+		if (!(f.x >= 0 && f.y >= 0 && f.z >= 0 && f.x < res && f.y < res && f.z < res)) return outside;
+		return cells[((int)f.z * res + (int)f.y) * res + (int)f.x];
+	}
+
+	//out[i] = at(position[i]) for every particle
+	template <class Vector, class Out>
+	void classify(const Vector& position, Out& out) const {
+		int count = position.size();
+		out.resize(count);
+		int i = 0;
+#ifdef REGION_SSE
+		__m128 lx = _mm_set1_ps(lo.x), ly = _mm_set1_ps(lo.y), lz = _mm_set1_ps(lo.z);
+		__m128 sx = _mm_set1_ps(invCell.x), sy = _mm_set1_ps(invCell.y), sz = _mm_set1_ps(invCell.z);
+		__m128 zero = _mm_setzero_ps(), size = _mm_set1_ps((float)res);
+		__m128 rowStride = _mm_set1_ps((float)res), sliceStride = _mm_set1_ps((float)(res * res));
+		for (; i + 4 <= count; i += 4) {
+			const glm::vec3* p = &position[i];
+			__m128 fx = _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x), lx), sx);
+			__m128 fy = _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y), ly), sy);
+			__m128 fz = _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z), lz), sz);
+			//false for NaN too
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(fx, zero), _mm_cmplt_ps(fx, size)),
+				_mm_and_ps(_mm_and_ps(_mm_cmpge_ps(fy, zero), _mm_cmplt_ps(fy, size)),
+					_mm_and_ps(_mm_cmpge_ps(fz, zero), _mm_cmplt_ps(fz, size))));
+			//truncated cell coordinates combined in float, exact below 2^24 cells
+			__m128 cx = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_and_ps(fx, inside)));
+			__m128 cy = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_and_ps(fy, inside)));
+			__m128 cz = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_and_ps(fz, inside)));
+			__m128i index = _mm_cvttps_epi32(_mm_add_ps(cx, _mm_add_ps(_mm_mul_ps(cy, rowStride), _mm_mul_ps(cz, sliceStride))));
+			int mask = _mm_movemask_ps(inside);
+#ifdef __AVX2__
+			__m128i words = _mm_i32gather_epi32((const int*)cells.data(), index, 1);
+			int w[4];
+			_mm_storeu_si128((__m128i*)w, words);
+			for (int k = 0; k < 4; k++) out[i + k] = (mask & (1 << k)) ? (unsigned char)w[k] : outside;
+#else
+			int idx[4];
+			_mm_storeu_si128((__m128i*)idx, index);
+			for (int k = 0; k < 4; k++) out[i + k] = (mask & (1 << k)) ? cells[idx[k]] : outside;
+#endif
+		}
+#endif
+		for (; i < count; i++) out[i] = at(position[i]);
+	}
+};
+
+#endif
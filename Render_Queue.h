@@ -0,0 +1,232 @@
+//Render queue for the demos
+//Include after glad and glm. Draws are collected with submit() during the frame and issued by flush(),
+//sorted by program, VAO, texture and mesh so each of them is bound once per frame instead of once per draw.
+//Draws of the same mesh with the same state keep the order they were submitted in, which the blended
+//demos rely on. Draws with different programs are ordered by the GL's program names, which say nothing
+//about opaque or blended, so flush() the opaque pass before submitting the blended one.
+//Per draw uniforms (color, alpha) are only sent when they differ from what the program already has.
+//Programs built with the INSTANCED variant that draw from the MeshArena get everything with the same
+//program and texture in one glMultiDrawArraysIndirect instead (see Mesh_Arena.h); those only take the
+//translate + uniform scale form of submit(). Their consecutive submits with the same state go into one
+//batch, a single item that only appends an instance per draw, so flush() sorts batches, not particles.
+//The camera matrices live in one uniform buffer, the Camera block in vertex.glsl, that every program
+//added with addProgram() reads, so they are uploaded once per frame instead of once per program.
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <algorithm>
+#include <vector>
+#include "Particle_Stats.h"
+#include "Mesh_Arena.h"
+
+#define CAMERA_BINDING 0 //uniform buffer binding point of the Camera block
+
+struct CameraBlock { //std140 layout of the Camera block in vertex.glsl
+	glm::mat4 view;
+	glm::mat4 proj;
+};
+
+struct DrawItem {
+	GLuint program, vao, texture;
+	GLint first;
+	GLsizei count;
+	bool uniformScale;       //centerRadius is used instead of model (UNIFORM_SCALE shader variant)
+	glm::vec4 centerRadius;
+	glm::mat4 model;
+	glm::vec3 color;
+	float alpha;
+	unsigned int order;      //submission order, keeps the sort stable without a temporary buffer
+	unsigned int firstInstance, numInstances; //a batch's slice of RenderQueue::instances, 0 instances otherwise
+};
+
+inline bool DrawItemLess(const DrawItem& a, const DrawItem& b) {
+	if (a.program != b.program) return a.program < b.program;
+	if (a.vao != b.vao) return a.vao < b.vao;
+	if (a.texture != b.texture) return a.texture < b.texture;
+	if (a.first != b.first) return a.first < b.first;
+	return a.order < b.order;
+}
+
+struct ProgramUniforms {
+	GLuint program;
+	GLint centerRadius, model, color, alpha;
+	bool instanced;          //per instance data comes from the MeshArena
+	bool colorSet = false;   //the program keeps its uniform values between frames
+	glm::vec3 lastColor;
+	float lastAlpha = 1.0f;  //default in fragment.glsl
+};
+
+struct RenderQueue {
+	GLuint cameraBuffer = 0;
+	MeshArena* arena = NULL; //for the multi draws of INSTANCED programs
+	std::vector<DrawItem> items;
+	std::vector<ArenaInstance> instances; //of all the batches, in submission order
+	std::vector<ProgramUniforms> programs;
+
+	void init(MeshArena* meshArena = NULL) {
+		arena = meshArena;
+		glGenBuffers(1, &cameraBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BINDING, cameraBuffer);
+		items.reserve(64);
+		instances.reserve(4096);
+	}
+
+	//Looks up the uniforms once and points the program's Camera block at the shared buffer
+	void addProgram(GLuint program) {
+		GLuint block = glGetUniformBlockIndex(program, "Camera");
+		if (block != GL_INVALID_INDEX) glUniformBlockBinding(program, block, CAMERA_BINDING);
+		ProgramUniforms u;
+		u.program = program;
+		u.centerRadius = glGetUniformLocation(program, "centerRadius");
+		u.model = glGetUniformLocation(program, "model");
+		u.color = glGetUniformLocation(program, "inColor");
+		u.alpha = glGetUniformLocation(program, "alpha");
+		u.instanced = glGetAttribLocation(program, "instColor") >= 0;
+		programs.push_back(u);
+	}
+
+	ProgramUniforms* findProgram(GLuint program) {
+		for (size_t i = 0; i < programs.size(); i++) {
+			if (programs[i].program == program) return &programs[i];
+		}
+		return NULL;
+	}
+
+	void setCamera(const glm::mat4& view, const glm::mat4& proj) {
+		CameraBlock camera = { view, proj };
+		glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(camera), &camera);
+	}
+
+	//Appends an item with the draw's state
+	DrawItem& push(GLuint program, const MeshRange& mesh, glm::vec3 color, float alpha, GLuint texture) {
+		DrawItem item;
+		item.program = program;
+		item.vao = mesh.vao;
+		item.texture = texture;
+		item.first = mesh.first;
+		item.count = mesh.count;
+		item.uniformScale = true;
+		item.color = color;
+		item.alpha = alpha;
+		item.order = items.size();
+		item.firstInstance = instances.size();
+		item.numInstances = 0;
+		items.push_back(item);
+		return items.back();
+	}
+
+	//True if the last item is a batch the draw can be appended to
+	bool extends(GLuint program, const MeshRange& mesh, GLuint texture) const {
+		if (items.empty()) return false;
+		const DrawItem& last = items.back();
+		return last.numInstances > 0 && last.program == program && last.vao == mesh.vao && last.texture == texture && last.first == mesh.first;
+	}
+
+	//A mesh that is only translated and uniformly scaled
+	void submit(GLuint program, const MeshRange& mesh, glm::vec3 center, float scale, glm::vec3 color, float alpha = 1.0f, GLuint texture = 0) {
+		if (!extends(program, mesh, texture)) {
+			ProgramUniforms* u = findProgram(program);
+			if (!(u && u->instanced && arena && mesh.vao == arena->vao)) {
+				push(program, mesh, color, alpha, texture).centerRadius = glm::vec4(center, scale);
+				return;
+			}
+			push(program, mesh, color, alpha, texture); //a new batch
+		}
+		ArenaInstance instance = { glm::vec4(center, scale), glm::vec4(color, alpha) };
+		instances.push_back(instance);
+		items.back().numInstances++;
+	}
+
+	//n instances of mesh for an INSTANCED program, filled in by the caller in draw order straight into the
+	//batch's slice of the instance buffer, without the per draw checks of submit(). The pointer is good
+	//until the next submit or flush().
+	ArenaInstance* submitInstances(GLuint program, const MeshRange& mesh, size_t n, GLuint texture = 0) {
+		if (n == 0) return NULL;
+		if (!extends(program, mesh, texture)) push(program, mesh, glm::vec3(0.0f), 1.0f, texture);
+		size_t start = instances.size();
+		instances.resize(start + n);
+		items.back().numInstances += n;
+		return &instances[start];
+	}
+
+	//A mesh with an arbitrary model matrix
+	void submit(GLuint program, const MeshRange& mesh, const glm::mat4& model, glm::vec3 color, float alpha = 1.0f, GLuint texture = 0) {
+		DrawItem& item = push(program, mesh, color, alpha, texture);
+		item.uniformScale = false;
+		item.model = model;
+	}
+
+	//Sorts and draws everything submitted this frame
+	void flush(ParticleStats& stats) {
+		std::sort(items.begin(), items.end(), DrawItemLess);
+
+		GLuint program = 0, vao = 0, texture = 0;
+		ProgramUniforms* u = NULL;
+		long long bytes = 0;
+		if (!instances.empty()) bytes += arena->uploadInstances(instances.data(), instances.size()); //once for all the batches
+		for (size_t i = 0; i < items.size();) {
+			const DrawItem& item = items[i];
+			if (u == NULL || item.program != program) {
+				program = item.program;
+				glUseProgram(program);
+				u = findProgram(program);
+			}
+			if (i == 0 || item.vao != vao) {
+				vao = item.vao;
+				glBindVertexArray(vao);
+			}
+			if (i == 0 || item.texture != texture) {
+				texture = item.texture;
+				glBindTexture(GL_TEXTURE_2D, texture);
+			}
+
+			if (item.numInstances > 0) {
+				//every batch up to the next state change goes into one multi draw
+				arena->commands.clear();
+				for (; i < items.size() && items[i].program == program && items[i].vao == vao && items[i].texture == texture; i++) {
+					const DrawItem& it = items[i];
+					arena->addCommand(it.first, it.count, it.firstInstance, it.numInstances);
+				}
+				bytes += arena->drawCommands(stats);
+				continue;
+			}
+
+			if (item.uniformScale) {
+				glUniform4f(u->centerRadius, item.centerRadius.x, item.centerRadius.y, item.centerRadius.z, item.centerRadius.w);
+				bytes += 4 * sizeof(float);
+			}
+			else {
+				glUniformMatrix4fv(u->model, 1, GL_FALSE, glm::value_ptr(item.model));
+				bytes += sizeof(glm::mat4);
+			}
+			if (!u->colorSet || item.color != u->lastColor) {
+				glUniform3f(u->color, item.color.r, item.color.g, item.color.b);
+				u->lastColor = item.color;
+				u->colorSet = true;
+				bytes += 3 * sizeof(float);
+			}
+			if (item.alpha != u->lastAlpha) {
+				glUniform1f(u->alpha, item.alpha);
+				u->lastAlpha = item.alpha;
+				bytes += sizeof(float);
+			}
+
+			glDrawArrays(GL_TRIANGLES, item.first, item.count);
+			stats.drew(item.count);
+			i++;
+		}
+		stats.uploaded(bytes);
+		items.clear();
+		instances.clear();
+	}
+
+	void deleteBuffer() {
+		glDeleteBuffers(1, &cameraBuffer);
+	}
+};
+
+#endif
@@ -0,0 +1,239 @@
+//Shader program loading for the demos
+//Include after glad and SDL.
+//  ShaderManager shaders;
+//  GLuint program = shaders.load("vertex.glsl", "fragment.glsl");  //queue as many as needed
+//  shaders.finish();                                                //wait for all of them
+//load() reads the files and hands the sources to the driver without waiting for the result, so with
+//GL_KHR_parallel_shader_compile the driver builds all queued programs on its own threads and finish()
+//only polls for completion. Loading the same files (and defines) twice returns the same program.
+//Linked programs are saved with glGetProgramBinary in shader_cache/, keyed by a hash of the sources
+//and the driver's vendor/renderer/version strings, so the next start skips compiling entirely.
+//defines is a list of "#define" lines inserted after #version, used for shader variants.
+
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+struct ShaderProgram {
+	GLuint id = 0;
+	std::string vsFile, fsFile, defines;
+	uint64_t hash = 0;
+	GLuint vertexShader = 0, fragmentShader = 0; //only while compiling
+	bool pending = false;   //linked but not checked yet
+	bool fromCache = false;
+};
+
+struct ShaderManager {
+	std::string cacheDir = "shader_cache";
+	bool useCache = true;
+	bool parallel = false; //GL_KHR_parallel_shader_compile is available
+	bool initialized = false;
+	std::string driver;
+	std::vector<ShaderProgram> programs;
+
+	static uint64_t hashString(const std::string& s, uint64_t h = 14695981039346656037ULL) {
+		for (size_t i = 0; i < s.size(); i++) {
+			h ^= (unsigned char)s[i];
+			h *= 1099511628211ULL; //FNV-1a
+		}
+		return h;
+	}
+
+	static bool readFile(const std::string& fileName, std::string& out) {
+		std::ifstream file(fileName.c_str(), std::ios::binary);
+		if (!file) return false;
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		out = buffer.str();
+		return true;
+	}
+
+	//puts the defines right after the #version line, which has to stay first
+	static std::string addDefines(const std::string& source, const std::string& defines) {
+		if (defines.empty()) return source;
+		size_t lineEnd = source.compare(0, 8, "#version") == 0 ? source.find('\n') : std::string::npos;
+		if (lineEnd == std::string::npos) return defines + "\n" + source;
+		return source.substr(0, lineEnd + 1) + defines + "\n" + source.substr(lineEnd + 1);
+	}
+
+	void init() {
+		initialized = true;
+		driver = std::string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+
+		if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile")) {
+			typedef void (APIENTRYP MaxThreadsProc)(GLuint count);
+			MaxThreadsProc maxThreads = (MaxThreadsProc)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR");
+			if (maxThreads) {
+				maxThreads(0xFFFFFFFF); //let the driver pick the number of threads
+				parallel = true;
+			}
+		}
+
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (formats == 0) useCache = false;
+		if (useCache) {
+#ifdef _WIN32
+			_mkdir(cacheDir.c_str());
+#else
+			mkdir(cacheDir.c_str(), 0755);
+#endif
+		}
+	}
+
+	std::string cacheFile(uint64_t hash) const {
+		char name[32];
+		sprintf(name, "/%016llx.bin", (unsigned long long)hash);
+		return cacheDir + name;
+	}
+
+	bool loadBinary(ShaderProgram& p) {
+		std::string data;
+		if (!useCache || !readFile(cacheFile(p.hash), data) || data.size() <= sizeof(GLenum)) return false;
+		GLenum format;
+		memcpy(&format, data.data(), sizeof(format));
+		p.id = glCreateProgram();
+		glProgramBinary(p.id, format, data.data() + sizeof(format), data.size() - sizeof(format));
+		GLint status;
+		glGetProgramiv(p.id, GL_LINK_STATUS, &status);
+		if (!status) { //driver update or corrupt file, compile it again
+			glDeleteProgram(p.id);
+			p.id = 0;
+			return false;
+		}
+		return true;
+	}
+
+	void saveBinary(const ShaderProgram& p) {
+		if (!useCache) return;
+		GLint length = 0;
+		glGetProgramiv(p.id, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) return;
+		std::vector<char> data(sizeof(GLenum) + length);
+		GLenum format;
+		glGetProgramBinary(p.id, length, NULL, &format, &data[sizeof(GLenum)]);
+		memcpy(&data[0], &format, sizeof(format));
+		std::ofstream file(cacheFile(p.hash).c_str(), std::ios::binary);
+		file.write(&data[0], data.size());
+	}
+
+	GLuint compile(GLenum type, const std::string& source) {
+		GLuint shader = glCreateShader(type);
+		const GLchar* text = source.c_str();
+		glShaderSource(shader, 1, &text, NULL);
+		glCompileShader(shader); //status is checked in finish()
+		return shader;
+	}
+
+	//Queues a program and returns its id, 0 if a file could not be read
+	GLuint load(const char* vsFile, const char* fsFile, const char* defines = "") {
+		if (!initialized) init();
+
+		std::string vs, fs;
+		if (!readFile(vsFile, vs) || !readFile(fsFile, fs)) {
+			printf("ERROR: Failed to read shader files %s and %s\n", vsFile, fsFile);
+			return 0;
+		}
+		vs = addDefines(vs, defines);
+		fs = addDefines(fs, defines);
+		uint64_t hash = hashString(driver, hashString(fs, hashString(vs)));
+
+		for (size_t i = 0; i < programs.size(); i++) {
+			if (programs[i].hash == hash) return programs[i].id; //identical program already loaded
+		}
+
+		ShaderProgram p;
+		p.vsFile = vsFile;
+		p.fsFile = fsFile;
+		p.defines = defines;
+		p.hash = hash;
+		p.fromCache = loadBinary(p);
+		if (!p.fromCache) {
+			p.vertexShader = compile(GL_VERTEX_SHADER, vs);
+			p.fragmentShader = compile(GL_FRAGMENT_SHADER, fs);
+			p.id = glCreateProgram();
+			glAttachShader(p.id, p.vertexShader);
+			glAttachShader(p.id, p.fragmentShader);
+			glBindFragDataLocation(p.id, 0, "outColor"); // set output
+			if (useCache) glProgramParameteri(p.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+			glLinkProgram(p.id);
+			p.pending = true;
+		}
+		programs.push_back(p);
+		return p.id;
+	}
+
+	void printLog(const ShaderProgram& p, GLuint shader, const char* what) {
+		char buffer[1024];
+		if (shader) glGetShaderInfoLog(shader, sizeof(buffer), NULL, buffer);
+		else glGetProgramInfoLog(p.id, sizeof(buffer), NULL, buffer);
+		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
+			"Compilation Error",
+			"Failed to Compile: Check Consol Output.",
+			NULL);
+		printf("%s Failed (%s, %s %s). Info:\n\n%s\n", what, p.vsFile.c_str(), p.fsFile.c_str(), p.defines.c_str(), buffer);
+	}
+
+	//Waits for every queued program, reports errors and fills the cache. Returns false if one failed
+	bool finish() {
+		if (parallel) { //wait until the driver threads are done with all of them
+			bool busy = true;
+			while (busy) {
+				busy = false;
+				for (size_t i = 0; i < programs.size(); i++) {
+					if (!programs[i].pending) continue;
+					GLint done = GL_TRUE;
+					glGetProgramiv(programs[i].id, GL_COMPLETION_STATUS_KHR, &done);
+					if (!done) busy = true;
+				}
+				if (busy) SDL_Delay(1);
+			}
+		}
+
+		bool ok = true;
+		for (size_t i = 0; i < programs.size(); i++) {
+			ShaderProgram& p = programs[i];
+			if (!p.pending) continue;
+			p.pending = false;
+
+			GLint status;
+			glGetShaderiv(p.vertexShader, GL_COMPILE_STATUS, &status);
+			if (!status) { printLog(p, p.vertexShader, "Vertex Shader Compile"); ok = false; }
+			glGetShaderiv(p.fragmentShader, GL_COMPILE_STATUS, &status);
+			if (!status) { printLog(p, p.fragmentShader, "Fragment Shader Compile"); ok = false; }
+			glGetProgramiv(p.id, GL_LINK_STATUS, &status);
+			if (!status) { printLog(p, 0, "Shader Link"); ok = false; }
+			else saveBinary(p);
+
+			glDetachShader(p.id, p.vertexShader);
+			glDetachShader(p.id, p.fragmentShader);
+			glDeleteShader(p.vertexShader);
+			glDeleteShader(p.fragmentShader);
+			p.vertexShader = p.fragmentShader = 0;
+		}
+		return ok;
+	}
+
+	void deleteAll() {
+		for (size_t i = 0; i < programs.size(); i++) glDeleteProgram(programs[i].id);
+		programs.clear();
+	}
+};
+
+#endif
@@ -0,0 +1,419 @@
+//CSCI 5611 OpenGL Animation Tutorial
+//Snowfall: textured snow flakes drifting in the wind
+
+//Running on Mac OSX
+//  Download the SDL2 Framework from here: https://www.libsdl.org/download-2.0.php
+//  Open the .dmg and move the file SDL2.Framework into the directory /Library/Frameworks/
+//  Make sure you place this cpp file in the same directory with the "glad" folder and the "glm" folder
+//  g++ Snowfall.cpp glad/glad.c -framework OpenGL -framework SDL2; ./a.out
+
+//Running on Windows
+//  Download the SDL2 *Development Libararies* from here: https://www.libsdl.org/download-2.0.php
+//  Place SDL2.dll, the 3 .lib files, and the include directory in locations known to MSVC
+//  Add both Snowfall.cpp and glad/glad.c to the project file
+//  Compile and run
+
+//Running on Ubuntu
+//  sudo apt-get install libsdl2-2.0-0 libsdl2-dev
+//  Make sure you place this cpp file in the same directory with the "glad" folder and the "glm" folder
+//  g++ Snowfall.cpp glad/glad.c -lGL -lSDL2; ./a.out
+
+//Every flake is a camera facing quad (snow.txt) with one of the sprites of a texture atlas, all of them
+//go out in one instanced draw through the MeshArena: centerRadius carries the flake's center and size,
+//the color slot its rectangle in the atlas (the SPRITE variant of vertexTex.glsl/fragmentTex.glsl).
+//The atlas is generated at startup, four six-fold flakes in a 2x2 grid with mipmaps.
+//Only the tiles around the camera are snowing (Tiled_Emitter.h): flakes never die, the ones leaving their
+//tile come back in on the other side and the tiles the camera leaves behind are moved ahead of it.
+
+#include "glad/glad.h"  //Include order can matter here
+#include "GL_Trace.h"  //build with -DGL_TRACE to count GL calls per frame
+#ifndef _WIN32
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_opengl.h>
+#else
+#include <SDL.h>
+#include <SDL_opengl.h>
+#endif
+#include <cstdio>
+#include <cmath>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define PARTICLE_NUM 200000 //flakes, spread over the tiles around the camera
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
+#include "glm/gtx/rotate_vector.hpp"
+#include "Benchmark.h"
+#include "Stats_Overlay.h"
+#include "Perf_Counters.h"
+#include "Alloc_Tracker.h" //build with -DTRACK_ALLOCS to count heap allocations per frame
+#include "Shader_Manager.h"
+#include "Render_Queue.h"
+#include "Frustum_Cull.h"
+#include "Overdraw_Heatmap.h"
+#include "Tiled_Emitter.h"
+
+#include <fstream>
+using namespace std;
+
+bool saveOutput = false; //Make to true to save out your animation
+int screen_width = 800;
+int screen_height = 600;
+
+ParticleVector<glm::vec3>position;
+ParticleVector<float>fallSpeed;
+ParticleVector<float>phase;    //offset of the flutter, so the flakes don't sway in step
+ParticleVector<float>flakeSize;
+ParticleVector<unsigned char>sprite; //cell of the atlas
+float maxSize = 0.06;
+float tileSize = 2.5;  //the snowing volume is (2*tileRadius+1)^2 tiles of tileSize x tileSize x boxHeight
+int tileRadius = 3;
+float boxHeight = 6.0;
+float floorPos = -1.2;
+
+bool fullscreen = false;
+void Win2PPM(int width, int height);
+void updateFlakes(float dt, float t);
+GLuint MakeFlakeAtlas(int cellSize);
+float randf();
+
+float aspect; //aspect ratio (needs to be updated if the window is resized)
+
+Benchmark bench; //enabled with --benchmark, see Benchmark.h
+ParticleStats stats; //per frame counters, see Particle_Stats.h
+StatsOverlay overlay;
+PerfCounters perf; //--perf, hardware counters per frame phase
+RenderQueue queue; //owns the camera buffer, see Render_Queue.h
+Frustum frustum; //flakes outside the view are not drawn
+TiledEmitter emitter; //keeps the snow around the camera
+OverdrawHeatmap heatmap; //--overdraw, fragments per pixel of the particle pass
+
+int main(int argc, char *argv[]) {
+	SDL_Init(SDL_INIT_VIDEO);  //Initialize Graphics (for OpenGL)
+	StatsParseArgs(stats, argc, argv);
+	OverdrawParseArgs(heatmap, argc, argv);
+	PerfParseArgs(perf, argc, argv);
+	BenchmarkParseArgs(bench, "snow", argc, argv);
+
+	//Ask SDL to get a recent version of OpenGL (3.2 or greater)
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 4);
+
+	//Create a window (offsetx, offsety, width, height, flags)
+	SDL_Window* window = SDL_CreateWindow("My OpenGL Program", 150, 50, screen_width, screen_height, SDL_WINDOW_OPENGL | (bench.enabled ? SDL_WINDOW_HIDDEN : 0));
+	aspect = screen_width / (float)screen_height; //aspect ratio (needs to be updated if the window is resized)
+
+	//Create a context to draw in
+	SDL_GLContext context = SDL_GL_CreateContext(window);
+
+	if (gladLoadGLLoader(SDL_GL_GetProcAddress)) {
+		printf("\nOpenGL loaded\n");
+		printf("Vendor:   %s\n", glGetString(GL_VENDOR));
+		printf("Renderer: %s\n", glGetString(GL_RENDERER));
+		printf("Version:  %s\n\n", glGetString(GL_VERSION));
+	}
+	else {
+		printf("ERROR: Failed to initialize OpenGL context.\n");
+		return -1;
+	}
+	if (bench.enabled) SDL_GL_SetSwapInterval(0); //don't wait for vsync while benchmarking
+	StatsOverlayInit(overlay);
+
+	//The flake quad, drawn instanced from the arena (see Mesh_Arena.h)
+	MeshArena arena;
+	int flakeMesh = arena.addMesh("snow.txt", MESH_POSITION_NORMAL_UV);
+	if (flakeMesh < 0) return -1;
+	arena.upload();
+	MeshRange flake = arena.mesh(flakeMesh);
+
+	//Load the shaders from vertexTex.glsl and fragmentTex.glsl (or the binary cache, see Shader_Manager.h)
+	ShaderManager shaders;
+	GLuint shaderProgram = shaders.load("vertexTex.glsl", "fragmentTex.glsl", "#define SPRITE");
+	heatmap.load(shaders, "vertexTex.glsl", "fragmentTex.glsl", "#define SPRITE");
+	shaders.finish();
+	heatmap.init(screen_width, screen_height);
+
+	//The queue points every program at the shared camera buffer
+	queue.init(&arena);
+	queue.addProgram(shaderProgram);
+	queue.addProgram(heatmap.countProgram);
+
+	GLuint atlas = MakeFlakeAtlas(128);
+	glm::vec4 atlasRect[4]; //corner and size of every sprite in texture coordinates
+	for (int k = 0; k < 4; k++) atlasRect[k] = glm::vec4((k % 2) * 0.5f, (k / 2) * 0.5f, 0.5f, 0.5f);
+
+	glEnable(GL_DEPTH_TEST);
+
+	//Event Loop (Loop forever processing each event as fast as possible)
+	SDL_Event windowEvent;
+	bool quit = false;
+
+	srand(bench.enabled ? bench.seed : time(NULL));
+
+	//set parameters for camera
+	float movestep = 0.1;
+	float anglestep = 0.1;
+	glm::vec3 camera_position = glm::vec3(3.f, 0.f, 0.f);  //Cam Position
+	glm::vec3 look_point = glm::vec3(0.0f, 0.0f, 0.0f);  //Look at point
+	glm::vec3 up_vector = glm::vec3(0.0f, 0.0f, 1.0f); //Up
+	glm::vec3 move_vector = glm::vec3(0.0f, 0.0f, 0.0f);
+
+	//the tiles around the camera are filled at the start, the flakes are recycled from then on
+	int tiles = (2 * tileRadius + 1) * (2 * tileRadius + 1);
+	emitter.init(PARTICLE_NUM / tiles, tileSize, tileRadius, floorPos, boxHeight, camera_position);
+	for (int i = 0; i < emitter.count(); i++) {
+		position.push_back(emitter.randomPoint(emitter.slotOf(i), randf(), randf(), randf()));
+		fallSpeed.push_back(0.3f + 0.4f * randf());
+		phase.push_back(randf() * 6.28f);
+		flakeSize.push_back(maxSize * (0.5f + 0.5f * randf()));
+		sprite.push_back(rand() % 4);
+	}
+	stats.born(emitter.count());
+
+	float lastTime = SDL_GetTicks() / 1000.f;
+	float dt = 0;
+	float simTime = 0;
+
+	while (!quit) {
+		while (SDL_PollEvent(&windowEvent)) {
+			if (windowEvent.type == SDL_QUIT) quit = true; //Exit event loop
+		  //List of keycodes: https://wiki.libsdl.org/SDL_Keycode - You can catch many special keys
+		  //Scancode referes to a keyboard position, keycode referes to the letter (e.g., EU keyboards)
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_ESCAPE)
+				quit = true; ; //Exit event loop
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_f) //If "f" is pressed
+				fullscreen = !fullscreen;
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_i) //"i" shows the stats overlay
+				overlay.visible = !overlay.visible;
+			if (windowEvent.type == SDL_KEYUP && windowEvent.key.keysym.sym == SDLK_h) //"h" shows the overdraw heatmap
+				heatmap.enabled = heatmap.supported && !heatmap.enabled;
+			SDL_SetWindowFullscreen(window, fullscreen ? SDL_WINDOW_FULLSCREEN : 0); //Set to full screen
+
+			if ((windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_UP) || \
+				(windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_w)) {
+				//move up
+				move_vector = glm::normalize(look_point - camera_position)*movestep;
+				camera_position = camera_position + move_vector;
+				look_point = look_point + move_vector;
+			}
+			if ((windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_DOWN) || \
+				(windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_s)) {
+				//move down
+				move_vector = glm::normalize(look_point - camera_position)*movestep;
+				camera_position = camera_position - move_vector;
+				look_point = look_point - move_vector;
+			}
+			if ((windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_LEFT) || \
+				(windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_a)) {
+				//move left
+				move_vector = glm::rotateZ(look_point - camera_position, anglestep);
+				look_point = camera_position + move_vector;
+			}
+			if ((windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_RIGHT) || \
+				(windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_d)) {
+				//move right
+				move_vector = glm::rotateZ(look_point - camera_position, -anglestep);
+				look_point = camera_position + move_vector;
+			}
+		}
+
+		// Clear the screen to the night sky
+		glClearColor(0.05f, 0.07f, 0.12f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		if (!saveOutput) dt = (SDL_GetTicks() / 1000.f) - lastTime;
+		if (dt > .1) dt = .1; //Have some max dt
+		lastTime = SDL_GetTicks() / 1000.f;
+		if (saveOutput) dt += .07; //Fix framerate at 14 FPS
+		if (bench.enabled) dt = bench.dt; //fixed step so benchmark runs are comparable
+		simTime += dt;
+		if (bench.enabled) { //fly forward, so streaming the tiles in is part of the measured frames
+			move_vector = glm::normalize(look_point - camera_position) * dt;
+			camera_position = camera_position + move_vector;
+			look_point = look_point + move_vector;
+		}
+
+		glm::mat4 view = glm::lookAt(camera_position, look_point, up_vector);
+
+		glm::mat4 proj = glm::perspective(3.14f / 4, aspect, 0.1f, 20.0f); //FOV, aspect, near, far
+		queue.setCamera(view, proj);
+		frustum.update(proj * view);
+		stats.uploaded(2 * sizeof(glm::mat4));
+
+		bench.beginFrame();
+		perf.begin(PHASE_SIMULATE);
+		emitter.stream(camera_position, position);
+		updateFlakes(dt, simTime);
+		bench.endSimulate(position.size());
+		perf.end(PHASE_SIMULATE);
+		perf.begin(PHASE_RENDER);
+
+		//tiles out of view are skipped whole, then every visible flake is one instance of the quad, all in one draw
+		frustum.visible.clear();
+		for (int s = 0; s < emitter.slots(); s++) {
+			if (!frustum.sphereVisible(emitter.tileCenter(s), emitter.tileRadius() + maxSize)) continue;
+			frustum.cullRange(position, s * emitter.perTile, (s + 1) * emitter.perTile, maxSize);
+		}
+		stats.culled(position.size() - frustum.visible.size());
+		if (heatmap.enabled) heatmap.begin();
+		glUseProgram(heatmap.enabled ? heatmap.countProgram : shaderProgram);
+		glBindVertexArray(arena.vao);
+		glBindTexture(GL_TEXTURE_2D, atlas);
+		arena.begin();
+		for (size_t v = 0; v < frustum.visible.size(); v++) {
+			int i = frustum.visible[v];
+			arena.add(flake.first, flake.count, glm::vec4(position[i], flakeSize[i]), atlasRect[sprite[i]]);
+		}
+		stats.uploaded(arena.draw(stats));
+		if (heatmap.enabled) heatmap.end(stats);
+
+		if (bench.enabled) glFinish(); //count the GPU work in the render phase
+		perf.end(PHASE_RENDER);
+		perf.endFrame();
+		bench.endRender();
+		if (bench.done()) {
+			bench.report();
+			quit = true;
+		}
+
+		if (saveOutput) Win2PPM(screen_width, screen_height);
+
+		stats.endFrame(position.size());
+		StatsOverlayDraw(overlay, stats, screen_width, screen_height);
+		allocTracker.endFrame();
+		glTraceEndFrame();
+
+		SDL_GL_SwapWindow(window); //Double buffering
+	}
+
+	//Clean Up
+	shaders.deleteAll();
+	queue.deleteBuffer();
+
+	glDeleteTextures(1, &atlas);
+	arena.deleteBuffers();
+	heatmap.deleteBuffers();
+
+	StatsOverlayDelete(overlay);
+	stats.close();
+	allocTracker.report();
+	perf.report();
+	glTraceReport();
+
+	SDL_GL_DeleteContext(context);
+	SDL_Quit();
+	return 0;
+}
+
+float randf() {
+	return (float)(rand() % 1001) * 0.001f;
+}
+
+//Falling, blown by slow gusts and fluttering sideways, flakes leaving their tile wrap to the other side
+void updateFlakes(float dt, float t) {
+	glm::vec3 wind = glm::vec3(0.8f + 0.5f * sin(0.23f * t), 0.3f * sin(0.37f * t + 1.0f), 0.0f);
+	for (int s = 0; s < emitter.slots(); s++) {
+		glm::vec2 lo = emitter.tileMin(s);
+		for (int i = s * emitter.perTile; i < (s + 1) * emitter.perTile; i++) {
+			glm::vec3 flutter = 0.2f * glm::vec3(sin(1.7f * t + phase[i]), cos(1.3f * t + phase[i]), 0.0f);
+			glm::vec3& p = position[i];
+			p = p + (wind + flutter - glm::vec3(0.0f, 0.0f, fallSpeed[i])) * dt;
+			emitter.wrap(p, lo);
+		}
+	}
+}
+
+//2x2 atlas of white flakes on a transparent background, cell k at ((k%2)/2, (k/2)/2)
+GLuint MakeFlakeAtlas(int cellSize) {
+	int texSize = 2 * cellSize;
+	std::vector<unsigned char> pixels(texSize * texSize * 4);
+	for (int k = 0; k < 4; k++) {
+		for (int py = 0; py < cellSize; py++) {
+			for (int px = 0; px < cellSize; px++) {
+				//centered coordinates in [-1,1], folded into one twelfth of the flake
+				float x = (px + 0.5f) / cellSize * 2 - 1, y = (py + 0.5f) / cellSize * 2 - 1;
+				float r = sqrt(x * x + y * y);
+				float a = fmod(atan2(y, x) + 6.2832f, 1.0472f); //60 degrees
+				if (a > 0.5236f) a = 1.0472f - a;
+				float along = r * cos(a), across = r * sin(a); //relative to the nearest arm
+				float coverage = 0;
+				if (k == 0) { //plain star
+					coverage = across < 0.06f && r < 0.85f ? 1.0f : 0.0f;
+				}
+				else if (k == 1) { //star with side branches
+					coverage = across < 0.05f && r < 0.85f ? 1.0f : 0.0f;
+					for (float b = 0.35f; b < 0.8f; b += 0.2f) { //branches leave the arm at 60 degrees
+						float d = fabs((along - b) * 0.866f - across * 0.5f);
+						if (d < 0.04f && along > b && across < 0.6f * (0.85f - b)) coverage = 1;
+					}
+				}
+				else if (k == 2) { //hexagonal plate with a hollow center
+					coverage = along < 0.7f && r > 0.15f ? 1.0f : 0.0f;
+				}
+				else { //soft round clump
+					coverage = r < 0.85f ? 1.0f - r / 0.85f : 0.0f;
+					coverage = coverage * coverage * 2;
+				}
+				if (coverage > 1) coverage = 1;
+				int tx = (k % 2) * cellSize + px, ty = (k / 2) * cellSize + py;
+				unsigned char* p = &pixels[(ty * texSize + tx) * 4];
+				p[0] = 235; p[1] = 240; p[2] = 255;
+				p[3] = (unsigned char)(coverage * 255);
+			}
+		}
+	}
+	GLuint tex;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, texSize, texSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return tex;
+}
+
+void Win2PPM(int width, int height) {
+	char outdir[10] = "out/"; //Must be defined!
+	int i, j;
+	FILE* fptr;
+	static int counter = 0;
+	char fname[32];
+	unsigned char *image;
+
+	/* Allocate our buffer for the image */
+	image = new (nothrow) unsigned char[3 * width*height];
+	if (image == NULL) {
+		fprintf(stderr, "ERROR: Failed to allocate memory for image\n");
+	}
+
+	/* Open the file */
+	sprintf(fname, "%simage_%04d.ppm", outdir, counter);
+	if ((fptr = fopen(fname, "w")) == NULL) {
+		fprintf(stderr, "ERROR: Failed to open file for window capture\n");
+	}
+
+	/* Copy the image into our buffer */
+	glReadBuffer(GL_BACK);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, image);
+
+	/* Write the PPM file */
+	fprintf(fptr, "P6\n%d %d\n255\n", width, height);
+	for (j = height - 1; j >= 0; j--) {
+		for (i = 0; i < width; i++) {
+			fputc(image[3 * j*width + 3 * i + 0], fptr);
+			fputc(image[3 * j*width + 3 * i + 1], fptr);
+			fputc(image[3 * j*width + 3 * i + 2], fptr);
+		}
+	}
+
+	delete[] image;
+	fclose(fptr);
+	counter++;
+}
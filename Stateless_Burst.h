@@ -0,0 +1,86 @@
+//Firework bursts with no per spark state, evaluated in the vertex shader
+//Include after glad, glm, Shader_Manager.h and Color_Gradient.h. A burst's sparks fly in straight lines
+//from one point at one speed, so a spark is a pure function of the burst, its index and the time: with
+//--stateless the CPU keeps only a BurstDescriptor and each frame sets a few uniforms and makes one
+//instanced draw of burst.count spheres. The BURST variant of vertex.glsl hashes gl_InstanceID with the
+//burst's seed into a direction (uniform on the sphere, like SphereSurfaceShape), moves the sphere along
+//it and looks up its color and alpha in the burst's gradient row. Sparks past the lifespan collapse to
+//a point and draw nothing.
+//  bursts.load(shaders);                  //before shaders.finish(), then queue.addProgram each program
+//  BurstDescriptor burst = { origin, startTime, 100000, seed, speed, lifeSpan, gradientRow };
+//  stats.uploaded(bursts.draw(burst, now, sphere, radius, gradients, program, stats));
+//The sparks can't be sorted on the CPU, so draw them with depth writes off or with weighted OIT.
+
+#ifndef STATELESS_BURST_H
+#define STATELESS_BURST_H
+
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+struct BurstDescriptor {
+	glm::vec3 origin;
+	float startTime;
+	int count;
+	uint32_t seed;
+	float speed;
+	float lifeSpan;
+	int gradientRow;
+};
+
+struct StatelessBursts {
+	bool enabled = false; //--stateless [sparks]
+	int sparks = 0;       //per burst, 0 for the scene's usual count
+	GLuint program = 0, oitProgram = 0, countProgram = 0;
+	GLint origin[3], params[3], seed[3]; //uniform locations per program, looked up once they are linked
+	bool located = false;
+
+	void load(ShaderManager& shaders) {
+		program = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED\n#define BURST");
+		oitProgram = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED\n#define BURST\n#define OIT");
+		countProgram = shaders.load("vertex.glsl", "fragment.glsl", "#define INSTANCED\n#define BURST\n#define OVERDRAW");
+	}
+
+	void locate() {
+		GLuint programs[3] = { program, oitProgram, countProgram };
+		for (int p = 0; p < 3; p++) {
+			origin[p] = glGetUniformLocation(programs[p], "burstOrigin");
+			params[p] = glGetUniformLocation(programs[p], "burstParams");
+			seed[p] = glGetUniformLocation(programs[p], "burstSeed");
+		}
+		located = true;
+	}
+
+	//True while some spark of the burst is still alive at time now
+	static bool alive(const BurstDescriptor& burst, float now) {
+		return now >= burst.startTime && now < burst.startTime + burst.lifeSpan;
+	}
+
+	//Draws the burst as it is at time now with prog (one of the three above), the arena VAO is bound here.
+	//Returns the bytes of uniforms set.
+	size_t draw(const BurstDescriptor& burst, float now, const MeshRange& mesh, float radius, const ColorGradients& gradients, GLuint prog, ParticleStats& stats) {
+		if (!alive(burst, now)) return 0;
+		if (!located) locate();
+		int p = prog == oitProgram ? 1 : (prog == countProgram ? 2 : 0);
+		glUseProgram(prog);
+		glBindVertexArray(mesh.vao);
+		glBindTexture(GL_TEXTURE_2D, gradients.tex);
+		glUniform4f(origin[p], burst.origin.x, burst.origin.y, burst.origin.z, now - burst.startTime);
+		glUniform4f(params[p], burst.speed, burst.lifeSpan, radius, (float)burst.gradientRow);
+		glUniform1ui(seed[p], burst.seed);
+		glDrawArraysInstanced(GL_TRIANGLES, mesh.first, mesh.count, burst.count);
+		stats.drew(mesh.count, burst.count);
+		return 2 * sizeof(glm::vec4) + sizeof(uint32_t);
+	}
+};
+
+inline void StatelessParseArgs(StatelessBursts& bursts, int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--stateless") == 0) {
+			bursts.enabled = true;
+			if (i + 1 < argc && atoi(argv[i + 1]) > 0) bursts.sparks = atoi(argv[++i]);
+		}
+	}
+}
+
+#endif
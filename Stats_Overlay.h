@@ -0,0 +1,191 @@
+//On-screen text overlay for ParticleStats (Particle_Stats.h)
+//Include after glad. Text is drawn with a built in 5x7 pixel font, each lit font pixel is one quad,
+//so there are no texture or font files to ship. Toggle it with the "i" key in the demos.
+
+#ifndef STATS_OVERLAY_H
+#define STATS_OVERLAY_H
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "Particle_Stats.h"
+
+//5x7 glyphs, one byte per row and the top row first, bit 4 is the leftmost column
+static const char overlayFontChars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ:./-%()";
+static const unsigned char overlayFont[][7] = {
+	{0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e}, //0
+	{0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e}, //1
+	{0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f}, //2
+	{0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e}, //3
+	{0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02}, //4
+	{0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e}, //5
+	{0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e}, //6
+	{0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, //7
+	{0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e}, //8
+	{0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c}, //9
+	{0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, //A
+	{0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e}, //B
+	{0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e}, //C
+	{0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c}, //D
+	{0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f}, //E
+	{0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10}, //F
+	{0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f}, //G
+	{0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, //H
+	{0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e}, //I
+	{0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c}, //J
+	{0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, //K
+	{0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f}, //L
+	{0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11}, //M
+	{0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, //N
+	{0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}, //O
+	{0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10}, //P
+	{0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d}, //Q
+	{0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11}, //R
+	{0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e}, //S
+	{0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, //T
+	{0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}, //U
+	{0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04}, //V
+	{0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a}, //W
+	{0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11}, //X
+	{0x11, 0x11, 0x0a, 0x04, 0x04, 0x04, 0x04}, //Y
+	{0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f}, //Z
+	{0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00}, //:
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c}, //.
+	{0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, ///
+	{0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00}, //-
+	{0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, //%
+	{0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, //(
+	{0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, //)
+};
+
+static const GLchar* overlayVertexSource =
+"#version 150 core\n"
+"in vec2 position;"
+"void main() {"
+"   gl_Position = vec4(position, 0.0, 1.0);"
+"}";
+
+static const GLchar* overlayFragmentSource =
+"#version 150 core\n"
+"uniform vec3 textColor;"
+"out vec4 outColor;"
+"void main() {"
+"   outColor = vec4(textColor, 1.0);"
+"}";
+
+struct StatsOverlay {
+	bool visible = false;
+	int pixelSize = 2; //screen pixels per font pixel
+	GLuint program = 0, vao = 0, vbo = 0;
+	GLint uniTextColor = -1;
+	std::vector<float> verts; //2D triangles in normalized device coordinates
+};
+
+inline bool StatsOverlayInit(StatsOverlay& overlay) {
+	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vs, 1, &overlayVertexSource, NULL);
+	glCompileShader(vs);
+	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fs, 1, &overlayFragmentSource, NULL);
+	glCompileShader(fs);
+
+	overlay.program = glCreateProgram();
+	glAttachShader(overlay.program, vs);
+	glAttachShader(overlay.program, fs);
+	glBindFragDataLocation(overlay.program, 0, "outColor");
+	glLinkProgram(overlay.program);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+
+	GLint status;
+	glGetProgramiv(overlay.program, GL_LINK_STATUS, &status);
+	if (!status) {
+		char buffer[512];
+		glGetProgramInfoLog(overlay.program, 512, NULL, buffer);
+		printf("Stats overlay shader failed to link. Info:\n\n%s\n", buffer);
+		return false;
+	}
+	overlay.uniTextColor = glGetUniformLocation(overlay.program, "textColor");
+
+	glGenVertexArrays(1, &overlay.vao);
+	glBindVertexArray(overlay.vao);
+	glGenBuffers(1, &overlay.vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, overlay.vbo);
+	GLint posAttrib = glGetAttribLocation(overlay.program, "position");
+	glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+	glEnableVertexAttribArray(posAttrib);
+	glBindVertexArray(0);
+	return true;
+}
+
+//Adds the quads for one line of text, (x,y) is the top left corner in pixels
+inline void StatsOverlayText(StatsOverlay& overlay, const char* text, int x, int y, int width, int height) {
+	float px = 2.0f * overlay.pixelSize / width, py = 2.0f * overlay.pixelSize / height;
+	float left = -1 + 2.0f * x / width, top = 1 - 2.0f * y / height;
+	for (int c = 0; text[c]; c++) {
+		char ch = text[c];
+		if (ch >= 'a' && ch <= 'z') ch += 'A' - 'a';
+		const char* found = ch == ' ' ? NULL : strchr(overlayFontChars, ch);
+		if (found == NULL) continue; //unknown characters are left blank like spaces
+		const unsigned char* glyph = overlayFont[found - overlayFontChars];
+		for (int row = 0; row < 7; row++) {
+			for (int col = 0; col < 5; col++) {
+				if (!(glyph[row] & (0x10 >> col))) continue;
+				float x0 = left + (c * 6 + col) * px, x1 = x0 + px;
+				float y0 = top - row * py, y1 = y0 - py;
+				float quad[12] = { x0, y0, x0, y1, x1, y1, x0, y0, x1, y1, x1, y0 };
+				overlay.verts.insert(overlay.verts.end(), quad, quad + 12);
+			}
+		}
+	}
+}
+
+//Draws the counters of the last finished frame in the top left corner
+inline void StatsOverlayDraw(StatsOverlay& overlay, const ParticleStats& stats, int width, int height) {
+	if (!overlay.visible || overlay.program == 0) return;
+	const FrameStats& f = stats.last;
+
+	char line[128];
+	int lineHeight = 9 * overlay.pixelSize, x = 8, y = 8;
+	overlay.verts.clear();
+	sprintf(line, "FRAME %.2f MS (%.0f FPS)", f.frameMs, f.frameMs > 0 ? 1000 / f.frameMs : 0.0);
+	StatsOverlayText(overlay, line, x, y, width, height); y += lineHeight;
+	sprintf(line, "ALIVE %d  CULLED %d", f.alive, f.offscreen);
+	StatsOverlayText(overlay, line, x, y, width, height); y += lineHeight;
+	sprintf(line, "BORN %d  DIED %d", f.births, f.deaths);
+	StatsOverlayText(overlay, line, x, y, width, height); y += lineHeight;
+	sprintf(line, "DRAWS %d  TRIS %lld", f.drawCalls, f.triangles);
+	StatsOverlayText(overlay, line, x, y, width, height); y += lineHeight;
+	sprintf(line, "UPLOAD %.1f KB", f.bytesUploaded / 1024.0);
+	StatsOverlayText(overlay, line, x, y, width, height); y += lineHeight;
+	if (f.overdrawMax > 0) {
+		sprintf(line, "OVERDRAW MAX %d  AVG %.2f", f.overdrawMax, f.overdrawAvg);
+		StatsOverlayText(overlay, line, x, y, width, height);
+	}
+
+	//draw on top of everything and put the demo's state back afterwards
+	GLint oldProgram, oldVao;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &oldVao);
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	glDisable(GL_DEPTH_TEST);
+
+	glUseProgram(overlay.program);
+	glUniform3f(overlay.uniTextColor, 1.0f, 1.0f, 0.3f);
+	glBindVertexArray(overlay.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, overlay.vbo);
+	glBufferData(GL_ARRAY_BUFFER, overlay.verts.size() * sizeof(float), overlay.verts.data(), GL_STREAM_DRAW);
+	glDrawArrays(GL_TRIANGLES, 0, overlay.verts.size() / 2);
+
+	glBindVertexArray(oldVao);
+	glUseProgram(oldProgram);
+	if (depthTest) glEnable(GL_DEPTH_TEST);
+}
+
+inline void StatsOverlayDelete(StatsOverlay& overlay) {
+	glDeleteProgram(overlay.program);
+	glDeleteBuffers(1, &overlay.vbo);
+	glDeleteVertexArrays(1, &overlay.vao);
+}
+
+#endif
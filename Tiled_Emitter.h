@@ -0,0 +1,102 @@
+//Camera relative volume emitter for weather that covers the whole world (Snowfall.cpp)
+//Include after glm. The ground is cut into square columns tileSize wide and only the (2*radius+1)^2 tiles
+//around the camera hold particles, perTile each, so the cost follows the simulated volume and not the
+//size of the world. Slot s owns the particles [s*perTile, (s+1)*perTile).
+//A tile goes to the slot given by its coordinates modulo the grid width, so when the camera crosses a tile
+//border only the row (or column) left behind changes hands: stream() moves its particles by whole grid
+//widths onto the new tiles ahead, with their spread and other attributes kept, nothing dies or respawns.
+//Particles leaving their tile sideways or the volume at the bottom come back in on the opposite face.
+//  emitter.init(perTile, tileSize, radius, bottom, height, camera_position);
+//  size the particle arrays to emitter.count(), place particle i at emitter.randomPoint(emitter.slotOf(i), ...)
+//  every frame: emitter.stream(camera_position, position) then move the particles of every slot and
+//  emitter.wrap(p, emitter.tileMin(slot)) them
+
+#ifndef TILED_EMITTER_H
+#define TILED_EMITTER_H
+
+#include <cmath>
+#include <vector>
+
+struct TiledEmitter {
+	int perTile = 0;
+	float tileSize = 2.5;
+	int radius = 3;          //tiles kept on each side of the camera's tile
+	float bottom = 0, height = 6;
+	glm::ivec2 center;       //the camera's tile
+	std::vector<glm::ivec2> tiles; //world tile held by every slot
+
+	int width() const { return 2 * radius + 1; }
+	int slots() const { return width() * width(); }
+	int count() const { return slots() * perTile; }
+	int slotOf(int i) const { return i / perTile; }
+
+	static int floorMod(int a, int n) {
+		int m = a % n;
+		return m < 0 ? m + n : m;
+	}
+
+	glm::ivec2 tileAt(const glm::vec3& p) const {
+		return glm::ivec2((int)floor(p.x / tileSize), (int)floor(p.y / tileSize));
+	}
+
+	//The tile of the grid around c that falls to slot
+	glm::ivec2 tileFor(int slot, const glm::ivec2& c) const {
+		int w = width();
+		glm::ivec2 lo = c - glm::ivec2(radius);
+		return lo + glm::ivec2(floorMod(slot % w - lo.x, w), floorMod(slot / w - lo.y, w));
+	}
+
+	glm::vec2 tileMin(int slot) const { return glm::vec2(tiles[slot]) * tileSize; }
+
+	//Bounding sphere of a slot's column, to reject whole tiles against the frustum
+	glm::vec3 tileCenter(int slot) const {
+		return glm::vec3(tileMin(slot) + glm::vec2(0.5f * tileSize), bottom + 0.5f * height);
+	}
+	float tileRadius() const { return 0.5f * sqrt(2 * tileSize * tileSize + height * height); }
+
+	void init(int perTileCount, float size, int tileRadius, float volumeBottom, float volumeHeight, const glm::vec3& camera) {
+		perTile = perTileCount;
+		tileSize = size;
+		radius = tileRadius;
+		bottom = volumeBottom;
+		height = volumeHeight;
+		center = tileAt(camera);
+		tiles.resize(slots());
+		for (int s = 0; s < slots(); s++) tiles[s] = tileFor(s, center);
+	}
+
+	//u, v, w in [0,1]
+	glm::vec3 randomPoint(int slot, float u, float v, float w) const {
+		return glm::vec3(tileMin(slot) + glm::vec2(u, v) * tileSize, bottom + w * height);
+	}
+
+	//Hands the tiles the camera left behind to the ones it moved towards, returns how many were moved
+	template <class Vector>
+	int stream(const glm::vec3& camera, Vector& position) {
+		glm::ivec2 c = tileAt(camera);
+		if (c == center) return 0;
+		center = c;
+		int moved = 0;
+		for (int s = 0; s < slots(); s++) {
+			glm::ivec2 t = tileFor(s, c);
+			if (t == tiles[s]) continue;
+			glm::vec3 offset = glm::vec3(glm::vec2(t - tiles[s]) * tileSize, 0.0f);
+			for (int i = s * perTile; i < (s + 1) * perTile; i++) position[i] += offset;
+			tiles[s] = t;
+			moved++;
+		}
+		return moved;
+	}
+
+	//Keeps a particle of the tile starting at lo inside it and the volume
+	void wrap(glm::vec3& p, const glm::vec2& lo) const {
+		if (p.x >= lo.x + tileSize) p.x -= tileSize;
+		else if (p.x < lo.x) p.x += tileSize;
+		if (p.y >= lo.y + tileSize) p.y -= tileSize;
+		else if (p.y < lo.y) p.y += tileSize;
+		if (p.z < bottom) p.z += height;
+		else if (p.z >= bottom + height) p.z -= height;
+	}
+};
+
+#endif
@@ -0,0 +1,129 @@
+//Weighted blended order independent transparency (McGuire and Bavoil, JCGT 2013)
+//Include after glad and Shader_Manager.h. Instead of sorting, the transparent particles are drawn in any
+//order into two targets: accum (RGBA16F) sums premultiplied color and alpha times a depth weight, reveal
+//(R16F) multiplies up (1 - alpha). end() then draws one full screen triangle that puts accum.rgb / accum.a
+//with alpha 1 - reveal over the window, using the demos' GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA blending.
+//The particles need a program with the OIT variant of fragment.glsl. Draw the opaque meshes to the window
+//first, begin(true) copies their depth so the particles behind them are still rejected.
+//  oit.load(shaders);                        //before shaders.finish()
+//  oit.init(screen_width, screen_height);    //after it
+//Only core features are used (half float targets, glBlendFunci), so it also runs headless on llvmpipe.
+
+#ifndef WEIGHTED_OIT_H
+#define WEIGHTED_OIT_H
+
+#include <cstdio>
+#include <cstring>
+#include "Particle_Stats.h"
+
+struct WeightedOIT {
+	bool enabled = false;   //--oit or the "o" key
+	bool supported = false; //the targets could be created
+	int width = 0, height = 0;
+	GLuint fbo = 0, accumTex = 0, revealTex = 0, depthTex = 0;
+	GLuint compositeProgram = 0, vao = 0;
+
+	void load(ShaderManager& shaders) {
+		compositeProgram = shaders.load("vertexScreen.glsl", "fragmentOIT.glsl");
+	}
+
+	static GLuint makeTexture(GLenum internalFormat, GLenum format, GLenum type, int w, int h) {
+		GLuint tex;
+		glGenTextures(1, &tex);
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format, type, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return tex;
+	}
+
+	//Creates the targets at the window size, returns false (and stays disabled) if they are not renderable
+	bool init(int w, int h) {
+		width = w;
+		height = h;
+		accumTex = makeTexture(GL_RGBA16F, GL_RGBA, GL_FLOAT, w, h);
+		revealTex = makeTexture(GL_R16F, GL_RED, GL_FLOAT, w, h);
+		depthTex = makeTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, w, h);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumTex, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealTex, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTex, 0);
+		GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, buffers);
+		supported = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		glGenVertexArrays(1, &vao); //the full screen triangle has no attributes, but core GL wants a VAO
+		glUseProgram(compositeProgram);
+		glUniform1i(glGetUniformLocation(compositeProgram, "accumTex"), 0);
+		glUniform1i(glGetUniformLocation(compositeProgram, "revealTex"), 1);
+		glUseProgram(0);
+
+		if (!supported || compositeProgram == 0) {
+			printf("ERROR: Weighted OIT targets are not renderable, sorting the particles instead\n");
+			supported = false;
+			enabled = false;
+		}
+		return supported;
+	}
+
+	//Starts drawing the transparent particles into the OIT targets. sceneDepth copies the depth of what
+	//was already drawn to the window, leave it false when there is nothing opaque.
+	void begin(bool sceneDepth) {
+		if (sceneDepth) {
+			glBindTexture(GL_TEXTURE_2D, depthTex);
+			glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height); //from the window, still bound
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		if (!sceneDepth) glClear(GL_DEPTH_BUFFER_BIT);
+		static const GLfloat zero[4] = { 0, 0, 0, 0 }, one[4] = { 1, 1, 1, 1 };
+		glClearBufferfv(GL_COLOR, 0, zero);
+		glClearBufferfv(GL_COLOR, 1, one);
+
+		glDepthMask(GL_FALSE); //test against the opaque depth, but particles don't hide each other
+		glBlendFunci(0, GL_ONE, GL_ONE);
+		glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+	}
+
+	//Composites the particles over the window and puts the demos' state back
+	void end(ParticleStats& stats) {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDepthMask(GL_TRUE);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDisable(GL_DEPTH_TEST);
+
+		glUseProgram(compositeProgram);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, revealTex);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, accumTex);
+		glBindVertexArray(vao);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		stats.drew(3);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	void deleteBuffers() {
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteTextures(1, &accumTex);
+		glDeleteTextures(1, &revealTex);
+		glDeleteTextures(1, &depthTex);
+		glDeleteVertexArrays(1, &vao);
+	}
+};
+
+inline void OITParseArgs(WeightedOIT& oit, int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--oit") == 0) oit.enabled = true;
+	}
+}
+
+#endif
@@ -0,0 +1,38 @@
+#version 330 core
+
+in vec3 Color;
+in vec3 normal;
+in vec3 lightDir;
+
+//Variants: OIT writes the weighted blended transparency targets instead of the color (Weighted_OIT.h)
+//          OVERDRAW writes 1 for every fragment, added up into the overdraw heatmap (Overdraw_Heatmap.h)
+#ifdef OIT
+layout(location = 0) out vec4 accum;
+layout(location = 1) out float reveal;
+#else
+out vec4 outColor;
+#endif
+
+#ifdef INSTANCED
+in float instAlpha;
+#define alpha instAlpha
+#else
+uniform float alpha = 1.0; //only the blended demos set it
+#endif
+
+const float ambient = .2;
+void main() {
+   vec3 diffuseC = Color * max(dot(lightDir, normal), 0);
+   vec3 ambC = Color * ambient;
+#ifdef OVERDRAW
+   outColor = vec4(1.0);
+#elif defined(OIT)
+   //nearer fragments weigh more, eq. 7 of McGuire and Bavoil, kept small so the 16 bit sums don't overflow
+   float z = 1.0 / gl_FragCoord.w; //view depth
+   float w = alpha * clamp(10.0 / (1e-5 + pow(z / 5.0, 2.0) + pow(z / 200.0, 6.0)), 1e-2, 3e3);
+   accum = vec4((diffuseC+ambC) * alpha, alpha) * w;
+   reveal = alpha;
+#else
+   outColor = vec4(diffuseC+ambC, alpha);
+#endif
+}
@@ -0,0 +1,23 @@
+#version 330 core
+
+//Scene depth for the low resolution particle pass, see Low_Res_Particles.h. Each texel takes the nearest
+//depth of its divisor x divisor block, so particles never show over the edge of an opaque mesh; the
+//upsample fills the pixels next to the edge from the neighbouring texels.
+
+uniform sampler2D sceneDepth; //window resolution
+uniform int divisor;
+
+layout(location = 1) out float lowDepth; //kept for the upsample, the particles write the depth buffer
+
+void main() {
+   ivec2 base = ivec2(gl_FragCoord.xy) * divisor;
+   ivec2 last = textureSize(sceneDepth, 0) - 1;
+   float d = 1.0;
+   for (int y = 0; y < divisor; y++) {
+      for (int x = 0; x < divisor; x++) {
+         d = min(d, texelFetch(sceneDepth, min(base + ivec2(x, y), last), 0).r);
+      }
+   }
+   gl_FragDepth = d;
+   lowDepth = d;
+}
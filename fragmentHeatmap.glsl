@@ -0,0 +1,25 @@
+#version 330 core
+
+//Color map of the particle fragment counts, see Overdraw_Heatmap.h
+
+uniform sampler2D counts;
+uniform float scale; //count shown red, more is white
+
+out vec4 outColor;
+
+const vec3 ramp[5] = vec3[](vec3(0,0,1), vec3(0,1,1), vec3(0,1,0), vec3(1,1,0), vec3(1,0,0));
+
+void main() {
+   float n = texelFetch(counts, ivec2(gl_FragCoord.xy), 0).r;
+   if (n < 0.5) {
+      outColor = vec4(0,0,0,1);
+      return;
+   }
+   if (n > scale) {
+      outColor = vec4(1,1,1,1);
+      return;
+   }
+   float t = clamp((n - 1.0) / max(scale - 1.0, 1.0), 0.0, 1.0) * 4.0;
+   int i = int(min(t, 3.0));
+   outColor = vec4(mix(ramp[i], ramp[i + 1], t - float(i)), 1.0);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+
+//Composite of the weighted blended transparency targets, see Weighted_OIT.h
+
+uniform sampler2D accumTex;  //sum of weighted premultiplied color, a = sum of weighted alpha
+uniform sampler2D revealTex; //product of (1 - alpha)
+
+out vec4 outColor;
+
+void main() {
+   ivec2 texel = ivec2(gl_FragCoord.xy);
+   float reveal = texelFetch(revealTex, texel, 0).r;
+   if (reveal >= 1.0) discard; //no particle covers this pixel
+   vec4 accum = texelFetch(accumTex, texel, 0);
+   accum = min(accum, vec4(65504.0)); //largest half float, in case the sums overflowed
+   outColor = vec4(accum.rgb / max(accum.a, 1e-5), 1.0 - reveal);
+}
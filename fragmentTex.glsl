@@ -1,4 +1,4 @@
-#version 150 core
+#version 330 core
 
 in vec3 Color;
 in vec3 normal;
@@ -10,10 +10,16 @@ out vec4 outColor;
 
 uniform sampler2D tex;
 
+//Variants: SPRITE cuts the shape out of the texture's alpha and draws the rest opaque, so the sprites
+//          need no sorting (Snowfall.cpp). OVERDRAW writes 1 per fragment for Overdraw_Heatmap.h
 
 const float ambient = .3;
 void main() {
-   vec3 Color = texture(tex, texcoord).rgb;
+   vec4 texel = texture(tex, texcoord);
+#ifdef SPRITE
+   if (texel.a < 0.3) discard;
+#endif
+   vec3 Color = texel.rgb;
    //vec3 Color = vec3(.2f,.2f,.6f);
    vec3 diffuseC = Color*max(dot(-lightDir,normal),0.0);
    vec3 ambC = Color*ambient;
@@ -23,5 +29,11 @@ void main() {
    if (dot(-lightDir,normal) <= 0.0)spec = 0;
    vec3 specC = .8*vec3(1.0,1.0,1.0)*pow(spec,4);
    vec3 oColor = ambC+diffuseC+specC;
+#ifdef OVERDRAW
+   outColor = vec4(1.0);
+#elif defined(SPRITE)
+   outColor = vec4(oColor,1.0);
+#else
    outColor = vec4(oColor,0.2);
+#endif
 }
\ No newline at end of file
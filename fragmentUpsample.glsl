@@ -0,0 +1,34 @@
+#version 330 core
+
+//Composite of the low resolution particle pass, see Low_Res_Particles.h. Every window pixel mixes the four
+//nearest low resolution texels, weighted bilinearly and by how close each texel's scene depth is to the
+//pixel's own, so texels from the other side of an opaque edge hardly count.
+
+uniform sampler2D particles;  //rgb premultiplied, a = how much of the scene shows through
+uniform sampler2D lowDepth;   //scene depth of each low resolution texel
+uniform sampler2D sceneDepth; //window resolution
+uniform int divisor;
+
+out vec4 outColor;
+
+void main() {
+   float depth = texelFetch(sceneDepth, ivec2(gl_FragCoord.xy), 0).r;
+   vec2 pos = gl_FragCoord.xy / float(divisor) - 0.5; //in low resolution texel centers
+   ivec2 base = ivec2(floor(pos));
+   vec2 f = pos - vec2(base);
+   ivec2 last = textureSize(particles, 0) - 1;
+
+   vec4 sum = vec4(0.0);
+   float total = 0.0;
+   for (int y = 0; y < 2; y++) {
+      for (int x = 0; x < 2; x++) {
+         ivec2 texel = clamp(base + ivec2(x, y), ivec2(0), last);
+         float bilinear = (x == 1 ? f.x : 1.0 - f.x) * (y == 1 ? f.y : 1.0 - f.y) + 1e-3;
+         float w = bilinear / (1e-4 + abs(depth - texelFetch(lowDepth, texel, 0).r));
+         sum += w * texelFetch(particles, texel, 0);
+         total += w;
+      }
+   }
+   outColor = sum / total;
+   if (outColor.a >= 1.0) discard; //no particle here
+}
@@ -0,0 +1,121 @@
+#version 330 core
+
+//Variants (defines passed to ShaderManager::load):
+//  UNIFORM_SCALE  the model is only translated and uniformly scaled, given as centerRadius instead of
+//                 a matrix. Normals need no transform then, which skips the per vertex inverse().
+//  INSTANCED      like UNIFORM_SCALE, but centerRadius and the color come per instance from the
+//                 MeshArena's instance buffer, so many meshes go in one multi draw (Mesh_Arena.h).
+//  GRADIENT       with INSTANCED, the instance color is (age, row) and the color and alpha are looked up
+//                 in that row of the gradient texture (Color_Gradient.h)
+//  BURST          with INSTANCED, instance i is spark i of a firework burst, placed and colored from the
+//                 burst uniforms, the instance id and the gradient texture alone (Stateless_Burst.h)
+//  BALLISTIC      with INSTANCED, the instance attributes are a drop's last launch (position and time,
+//                 velocity) and the drop is put where that parabola is now, in inColor (Ballistic_Events.h)
+//  COMPACT        with INSTANCED, the instance attributes are a particle's position quantized to 16 bits
+//                 per axis inside the bounds, one attribute per axis, drawn in inColor (Compact_Particles.h)
+//The attribute locations match the ATTRIB_ defines in Mesh_Arena.h.
+
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec3 inNormal;
+
+const vec3 inLightDir = normalize(vec3(0,2,2));
+
+out vec3 Color;
+out vec3 normal;
+out vec3 lightDir;
+
+#ifdef BURST
+#define UNIFORM_SCALE
+uniform vec4 burstOrigin; //xyz = where the sparks start, w = seconds since the burst
+uniform vec4 burstParams; //x = speed, y = lifespan, z = spark radius, w = gradient row
+uniform uint burstSeed;
+uniform sampler2D gradient;
+out float instAlpha;
+vec4 centerRadius; //set per spark in main()
+
+//PCG hash, a well mixed 32 bit value from a 32 bit value
+uint sparkHash(uint v) {
+   uint state = v * 747796405u + 2891336453u;
+   uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+   return (word >> 22u) ^ word;
+}
+#elif defined(BALLISTIC)
+#define UNIFORM_SCALE
+layout(location = 3) in vec4 launchPositionTime; //xyz = where, w = when
+layout(location = 4) in vec4 launchVelocity;
+uniform vec4 ballisticTime; //x = now, y = floor height, z = drop radius
+uniform vec3 gravity;
+out float instAlpha;
+vec4 centerRadius; //set per drop in main()
+#elif defined(COMPACT)
+#define UNIFORM_SCALE
+layout(location = 3) in float quantizedX; //normalized unsigned shorts, 0..1 across the bounds
+layout(location = 4) in float quantizedY;
+layout(location = 5) in float quantizedZ;
+uniform vec4 boundsMinRadius; //xyz = the bounds' low corner, w = particle radius
+uniform vec3 boundsSize;
+out float instAlpha;
+vec4 centerRadius; //set per particle in main()
+#elif defined(INSTANCED)
+#define UNIFORM_SCALE
+layout(location = 3) in vec4 centerRadius; //xyz = translation, w = scale
+layout(location = 4) in vec4 instColor;    //a = alpha
+out float instAlpha;
+#ifdef GRADIENT
+uniform sampler2D gradient; //bound by the render queue as the draw's texture
+#endif
+#elif defined(UNIFORM_SCALE)
+uniform vec4 centerRadius; //xyz = translation, w = scale
+#else
+uniform mat4 model;
+#endif
+layout(std140) uniform Camera { //one buffer shared by all programs, see Render_Queue.h
+   mat4 view;
+   mat4 proj;
+};
+uniform vec3 inColor;
+
+void main() {
+#if defined(BURST)
+   uint h = sparkHash(uint(gl_InstanceID) ^ burstSeed);
+   float z = 1.0 - 2.0 * float(h >> 8u) / 16777216.0; //uniform height is uniform on the sphere
+   float phi = 6.2831853 * float(sparkHash(h) >> 8u) / 16777216.0;
+   float r = sqrt(max(1.0 - z * z, 0.0));
+   float t = burstOrigin.w;
+   float age = t / burstParams.y;
+   centerRadius = vec4(burstOrigin.xyz + vec3(r * cos(phi), r * sin(phi), z) * (burstParams.x * t), age < 1.0 ? burstParams.z : 0.0);
+   vec2 size = vec2(textureSize(gradient, 0));
+   vec4 c = textureLod(gradient, vec2((clamp(age, 0.0, 1.0) * (size.x - 1.0) + 0.5) / size.x, (burstParams.w + 0.5) / size.y), 0.0);
+   Color = c.rgb;
+   instAlpha = c.a;
+#elif defined(BALLISTIC)
+   float t = ballisticTime.x - launchPositionTime.w;
+   vec3 center = launchPositionTime.xyz + launchVelocity.xyz * t + gravity * (0.5 * t * t);
+   centerRadius = vec4(center.xy, max(center.z, ballisticTime.y), ballisticTime.z);
+   Color = inColor;
+   instAlpha = 1.0;
+#elif defined(COMPACT)
+   centerRadius = vec4(boundsMinRadius.xyz + vec3(quantizedX, quantizedY, quantizedZ) * boundsSize, boundsMinRadius.w);
+   Color = inColor;
+   instAlpha = 1.0;
+#elif defined(INSTANCED) && defined(GRADIENT)
+   vec2 size = vec2(textureSize(gradient, 0));
+   vec4 c = textureLod(gradient, vec2((instColor.x * (size.x - 1.0) + 0.5) / size.x, (instColor.y + 0.5) / size.y), 0.0);
+   Color = c.rgb;
+   instAlpha = c.a;
+#elif defined(INSTANCED)
+   Color = instColor.rgb;
+   instAlpha = instColor.a;
+#else
+   Color = inColor;
+#endif
+#ifdef UNIFORM_SCALE
+   gl_Position = proj * view * vec4(position * centerRadius.w + centerRadius.xyz, 1.0);
+   normal = inNormal;
+#else
+   gl_Position = proj * view * model * vec4(position, 1.0);
+   vec4 norm4 = transpose(inverse(model)) * vec4(inNormal, 1.0);
+   normal = normalize(norm4.xyz);
+#endif
+   lightDir = (view * vec4(inLightDir, 0)).xyz;
+}
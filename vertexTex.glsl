@@ -1,12 +1,18 @@
-#version 150 core
+#version 330 core
 
-in vec3 position;
+//Variants (defines passed to ShaderManager::load):
+//  SPRITE  camera facing quads drawn instanced from the MeshArena (Snowfall.cpp). The mesh is snow.txt,
+//          a unit quad in the yz plane. Per instance, centerSize is the center and size and atlasRect
+//          (the arena's color slot) is the sprite's corner and size in the texture atlas.
+//The attribute locations match the ATTRIB_ defines in Mesh_Arena.h.
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 inTexcoord;
+layout(location = 2) in vec3 inNormal;
 //in vec3 inColor;
 
 //const vec3 inColor = vec3(0.f,0.7f,0.f);
 const vec3 inLightDir = normalize(vec3(-1,1,-1));
-in vec3 inNormal;
-in vec2 inTexcoord;
 
 out vec3 Color;
 out vec3 normal;
@@ -14,12 +20,30 @@ out vec3 pos;
 out vec3 lightDir;
 out vec2 texcoord;
 
+#ifdef SPRITE
+layout(location = 3) in vec4 centerSize; //xyz = center, w = size
+layout(location = 4) in vec4 atlasRect;  //xy = corner, zw = size in texture coordinates
+layout(std140) uniform Camera { //one buffer shared by all programs, see Render_Queue.h
+   mat4 view;
+   mat4 proj;
+};
+#else
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 proj;
+#endif
 uniform vec3 inColor;
 
 void main() {
+#ifdef SPRITE
+   Color = vec3(1.0);
+   //the quad is spread out in view space, so it always faces the camera
+   pos = (view * vec4(centerSize.xyz, 1.0)).xyz + vec3(position.y, position.z, 0.0) * centerSize.w;
+   gl_Position = proj * vec4(pos, 1.0);
+   lightDir = (view * vec4(inLightDir,0.0)).xyz; //It's a vector!
+   normal = vec3(0.0, 0.0, 1.0);
+   texcoord = atlasRect.xy + inTexcoord * atlasRect.zw;
+#else
    Color = inColor;
    gl_Position = proj * view * model * vec4(position,1.0);
    pos = (view * model * vec4(position,1.0)).xyz;
@@ -27,4 +51,5 @@ void main() {
    vec4 norm4 = transpose(inverse(view*model)) * vec4(inNormal,0.0);
    normal = normalize(norm4.xyz);
    texcoord = inTexcoord;
-}
\ No newline at end of file
+#endif
+}